@@ -10,7 +10,9 @@ SUBDIRS   += \
     swfgfxreader \
     swfdump \
     swfextract \
-    swf2sam
+    swf2sam \
+    swf2sambench \
+    swf2samtest
 
 swfrfx.depends = swfbase
 swfgfx.depends = swfrfx
@@ -19,3 +21,5 @@ swfgfxreader.depends = swfgfx
 swfdump.depends = swfgfxreader
 swfextract.depends = swfgfxreader
 swf2sam.depends = swfgfxreader
+swf2sambench.depends = swfgfxreader
+swf2samtest.depends = swfgfxreader
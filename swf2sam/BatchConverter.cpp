@@ -0,0 +1,332 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "BatchConverter.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+static const QString SWF_FILTER("*.swf");
+
+BatchConverter::Item::Item()
+	: result(Converter::OK)
+	, skipped(false)
+{
+}
+
+BatchConverter::BatchConverter()
+	: mThreadCount(0)
+	, mResult(OK)
+{
+}
+
+void BatchConverter::setConverter(const Converter &prototype)
+{
+	mPrototype = prototype;
+}
+
+void BatchConverter::setOutputDirPath(const QString &path)
+{
+	mOutputDirPath = path;
+}
+
+void BatchConverter::setThreadCount(int count)
+{
+	mThreadCount = count;
+}
+
+bool BatchConverter::addInput(const QString &input)
+{
+	QFileInfo fileInfo(input);
+
+	if (fileInfo.isDir())
+		return addDirectory(input);
+
+	if (fileInfo.isFile())
+	{
+		if (0 == fileInfo.suffix().compare("swf", Qt::CaseInsensitive))
+			return addFile(input, QString());
+
+		return addManifest(input);
+	}
+
+	static const QRegularExpression wildcardChars("[*?\\[]");
+
+	if (input.contains(wildcardChars))
+		return addWildcard(input);
+
+	mErrorInfo = input;
+	mResult = INPUT_NOT_FOUND;
+	return false;
+}
+
+bool BatchConverter::addFile(
+	const QString &filePath, const QString &relativeDirPath)
+{
+	auto outputDirPath = mOutputDirPath;
+
+	if (not relativeDirPath.isEmpty() && relativeDirPath != ".")
+	{
+		outputDirPath = QDir(mOutputDirPath).filePath(relativeDirPath);
+	}
+
+	// Converter names output by the input base name, so equal names
+	// would write the same files at the same time.
+	// Case is ignored for case-insensitive file systems.
+	auto baseName = QFileInfo(filePath).baseName();
+	auto outputPath =
+		QDir::cleanPath(QDir(outputDirPath).filePath(baseName)).toLower();
+	auto inputPath = QFileInfo(filePath).absoluteFilePath();
+
+	auto it = mOutputs.find(outputPath);
+
+	if (it != mOutputs.end())
+	{
+		// The same file listed twice is converted once
+		if (it->second == inputPath)
+			return true;
+
+		mErrorInfo = filePath;
+		mResult = DUPLICATE_OUTPUT;
+		return false;
+	}
+
+	mOutputs[outputPath] = inputPath;
+
+	mItems.emplace_back();
+	Item &item = mItems.back();
+
+	item.inputFilePath = filePath;
+	item.outputDirPath = outputDirPath;
+	return true;
+}
+
+bool BatchConverter::addDirectory(const QString &dirPath)
+{
+	QDir dir(dirPath);
+	QDirIterator it(dirPath, QStringList(SWF_FILTER), QDir::Files,
+		QDirIterator::Subdirectories);
+
+	QStringList filePaths;
+
+	while (it.hasNext())
+		filePaths.append(it.next());
+
+	if (filePaths.isEmpty())
+	{
+		mErrorInfo = dirPath;
+		mResult = INPUT_NOT_FOUND;
+		return false;
+	}
+
+	// keep output order stable between runs
+	filePaths.sort();
+
+	for (auto &filePath : filePaths)
+	{
+		if (not addFile(
+				filePath, dir.relativeFilePath(QFileInfo(filePath).path())))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool BatchConverter::addWildcard(const QString &pattern)
+{
+	QFileInfo patternInfo(pattern);
+	QDir dir(patternInfo.path());
+
+	auto fileNames = dir.entryList(
+		QStringList(patternInfo.fileName()), QDir::Files, QDir::Name);
+
+	if (fileNames.isEmpty())
+	{
+		mErrorInfo = pattern;
+		mResult = INPUT_NOT_FOUND;
+		return false;
+	}
+
+	for (auto &fileName : fileNames)
+	{
+		if (not addFile(dir.filePath(fileName), QString()))
+			return false;
+	}
+
+	return true;
+}
+
+bool BatchConverter::addManifest(const QString &manifestFilePath)
+{
+	QFile file(manifestFilePath);
+
+	if (not file.open(QFile::ReadOnly | QFile::Text))
+	{
+		mErrorInfo = manifestFilePath;
+		mResult = MANIFEST_OPEN_ERROR;
+		return false;
+	}
+
+	QDir manifestDir(QFileInfo(manifestFilePath).path());
+	QTextStream stream(&file);
+
+	while (not stream.atEnd())
+	{
+		auto line = stream.readLine().trimmed();
+
+		if (line.isEmpty() || line.startsWith('#'))
+			continue;
+
+		auto filePath = manifestDir.filePath(line);
+
+		if (QFileInfo(filePath).isDir())
+		{
+			if (not addDirectory(filePath))
+				return false;
+
+			continue;
+		}
+
+		if (not addFile(filePath, QString()))
+			return false;
+	}
+
+	return true;
+}
+
+int BatchConverter::exec()
+{
+	if (mResult != OK)
+		return mResult;
+
+	if (mPrototype.result() != Converter::OK)
+	{
+		mErrorInfo = mPrototype.errorMessage();
+		mResult = CONVERSION_FAILED;
+		return mResult;
+	}
+
+	QThreadPool pool;
+
+	pool.setMaxThreadCount(
+		mThreadCount > 0 ? mThreadCount : QThread::idealThreadCount());
+
+	for (Item &item : mItems)
+	{
+		QtConcurrent::run(
+			&pool, [this, &item]() { convert(mPrototype, item); });
+	}
+
+	pool.waitForDone();
+
+	for (const Item &item : mItems)
+	{
+		if (item.result != Converter::OK)
+		{
+			mResult = CONVERSION_FAILED;
+			break;
+		}
+	}
+
+	return mResult;
+}
+
+QString BatchConverter::errorMessage() const
+{
+	switch (mResult)
+	{
+		case INPUT_NOT_FOUND:
+			return QString("No SWF-files found for '%1'.").arg(mErrorInfo);
+
+		case MANIFEST_OPEN_ERROR:
+			return QString("Unable to open manifest file '%1'.")
+				.arg(mErrorInfo);
+
+		case DUPLICATE_OUTPUT:
+			return QString("Output of '%1' has the same name as output of "
+						   "another SWF-file.")
+				.arg(mErrorInfo);
+
+		case CONVERSION_FAILED:
+			if (not mErrorInfo.isEmpty())
+				return mErrorInfo;
+
+			return QString("Batch conversion failed.");
+	}
+
+	return QString();
+}
+
+QString BatchConverter::summary() const
+{
+	QStringList lines;
+	size_t failedCount = 0;
+	size_t warningCount = 0;
+	size_t skippedCount = 0;
+
+	for (const Item &item : mItems)
+	{
+		if (item.skipped)
+			skippedCount++;
+
+		if (item.result != Converter::OK)
+		{
+			failedCount++;
+			lines.append(QString("FAILED %1").arg(item.inputFilePath));
+		} else if (not item.warnings.empty())
+		{
+			warningCount++;
+			lines.append(QString("WARNING %1").arg(item.inputFilePath));
+		} else
+		{
+			continue;
+		}
+
+		for (auto &message : item.errorMessage.split('\n'))
+		{
+			if (not message.isEmpty())
+				lines.append(QString("    %1").arg(message));
+		}
+	}
+
+	lines.append(QString("Converted %1 of %2 files "
+						 "(%3 with warnings, %4 up to date).")
+					 .arg(mItems.size() - failedCount)
+					 .arg(mItems.size())
+					 .arg(warningCount)
+					 .arg(skippedCount));
+
+	return lines.join('\n');
+}
+
+void BatchConverter::convert(const Converter &prototype, Item &item)
+{
+	Converter cvt(prototype);
+
+	cvt.setInputFilePath(item.inputFilePath);
+	cvt.setOutputDirPath(item.outputDirPath);
+	cvt.setBufferedLog(true);
+
+	item.result = cvt.exec();
+
+	// One block per file, so concurrent conversions do not interleave
+	if (not cvt.log().isEmpty())
+		qInfo().noquote() << cvt.log().join('\n');
+
+	item.errorMessage = cvt.errorMessage();
+	item.warnings = cvt.warnings();
+	item.skipped = cvt.skipped();
+}
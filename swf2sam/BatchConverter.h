@@ -0,0 +1,91 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include "Converter.h"
+
+#include <QStringList>
+
+#include <map>
+#include <vector>
+
+class BatchConverter
+{
+public:
+	enum
+	{
+		OK,
+		INPUT_NOT_FOUND,
+		MANIFEST_OPEN_ERROR,
+		CONVERSION_FAILED,
+		DUPLICATE_OUTPUT
+	};
+
+	struct Item
+	{
+		QString inputFilePath;
+		QString outputDirPath;
+		QString errorMessage;
+		Converter::Warnings warnings;
+		int result;
+		bool skipped;
+
+		Item();
+	};
+
+	using Items = std::vector<Item>;
+
+	BatchConverter();
+
+	void setConverter(const Converter &prototype);
+	void setOutputDirPath(const QString &path);
+	void setThreadCount(int count);
+
+	bool addInput(const QString &input);
+
+	int exec();
+	inline int result() const;
+	inline const QString &errorInfo() const;
+	inline const Items &items() const;
+
+	QString errorMessage() const;
+	QString summary() const;
+
+private:
+	// Fails if another input file has the same output path
+	bool addFile(const QString &filePath, const QString &relativeDirPath);
+	bool addDirectory(const QString &dirPath);
+	bool addWildcard(const QString &pattern);
+	bool addManifest(const QString &manifestFilePath);
+
+	static void convert(const Converter &prototype, Item &item);
+
+	Converter mPrototype;
+	Items mItems;
+
+	// Input file path by output SAM-file path without suffix
+	std::map<QString, QString> mOutputs;
+	QString mOutputDirPath;
+	QString mErrorInfo;
+	int mThreadCount;
+	int mResult;
+};
+
+int BatchConverter::result() const
+{
+	return mResult;
+}
+
+const QString &BatchConverter::errorInfo() const
+{
+	return mErrorInfo;
+}
+
+const BatchConverter::Items &BatchConverter::items() const
+{
+	return mItems;
+}
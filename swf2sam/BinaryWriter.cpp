@@ -0,0 +1,112 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "BinaryWriter.h"
+
+#include <QIODevice>
+
+BinaryWriter::BinaryWriter(QIODevice *device, int blockSize)
+	: mDevice(device)
+	, mData(nullptr)
+	, mFlushed(0)
+	, mSize(0)
+	, mBlockSize(qMax(blockSize, 1))
+	, mOk(true)
+{
+	if (nullptr != mDevice)
+	{
+		mBuffer.resize(mBlockSize);
+		mData = mBuffer.data();
+	}
+}
+
+BinaryWriter::~BinaryWriter()
+{
+	flush();
+}
+
+void BinaryWriter::reserve(int size)
+{
+	if (nullptr != mDevice)
+		return;
+
+	if (mBuffer.size() - mSize < size)
+	{
+		mBuffer.resize(mSize + size);
+		mData = mBuffer.data();
+	}
+}
+
+void BinaryWriter::writeRawData(const char *data, int len)
+{
+	if (len <= 0)
+		return;
+
+	if (nullptr != mDevice && len >= mBlockSize)
+	{
+		// Do not copy large blocks to the buffer
+		writeBuffer();
+
+		if (mOk && mDevice->write(data, len) != len)
+			mOk = false;
+
+		mFlushed += len;
+		return;
+	}
+
+	if (mBuffer.size() - mSize < len)
+		makeRoom(len);
+
+	memcpy(mData + mSize, data, size_t(len));
+	mSize += len;
+}
+
+bool BinaryWriter::flush()
+{
+	writeBuffer();
+
+	return mOk;
+}
+
+QByteArray BinaryWriter::takeData()
+{
+	Q_ASSERT(nullptr == mDevice);
+
+	QByteArray result;
+	mBuffer.resize(mSize);
+	result.swap(mBuffer);
+
+	mData = nullptr;
+	mFlushed += mSize;
+	mSize = 0;
+
+	return result;
+}
+
+void BinaryWriter::makeRoom(int len)
+{
+	if (nullptr != mDevice)
+	{
+		writeBuffer();
+
+		if (mBuffer.size() >= len)
+			return;
+	}
+
+	mBuffer.resize(qMax(mBuffer.size() * 2, mSize + len));
+	mData = mBuffer.data();
+}
+
+void BinaryWriter::writeBuffer()
+{
+	if (nullptr == mDevice || mSize == 0)
+		return;
+
+	if (mOk && mDevice->write(mData, mSize) != mSize)
+		mOk = false;
+
+	mFlushed += mSize;
+	mSize = 0;
+}
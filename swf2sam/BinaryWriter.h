@@ -0,0 +1,165 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QtEndian>
+
+class QIODevice;
+
+// Little-endian binary serializer writing to a contiguous buffer.
+// With a device the buffer is flushed in blocks of blockSize bytes,
+// without a device all data stays in memory until takeData().
+// Write errors are sticky and reported by ok().
+class BinaryWriter
+{
+public:
+	enum
+	{
+		DEFAULT_BLOCK_SIZE = 1 << 20
+	};
+
+	explicit BinaryWriter(
+		QIODevice *device = nullptr, int blockSize = DEFAULT_BLOCK_SIZE);
+	~BinaryWriter();
+
+	BinaryWriter(const BinaryWriter &) = delete;
+	BinaryWriter &operator=(const BinaryWriter &) = delete;
+
+	// Preallocates memory for size more bytes
+	void reserve(int size);
+
+	inline BinaryWriter &operator<<(quint8 value);
+	inline BinaryWriter &operator<<(qint8 value);
+	inline BinaryWriter &operator<<(quint16 value);
+	inline BinaryWriter &operator<<(qint16 value);
+	inline BinaryWriter &operator<<(quint32 value);
+	inline BinaryWriter &operator<<(qint32 value);
+	inline BinaryWriter &operator<<(quint64 value);
+	inline BinaryWriter &operator<<(qint64 value);
+
+	void writeRawData(const char *data, int len);
+
+	// LEB128 variable length integers, signed ones are zigzag encoded
+	// so small negative values stay short
+	inline void writeVarUInt(quint32 value);
+	inline void writeVarInt(qint32 value);
+
+	inline bool ok() const;
+	inline qint64 pos() const;
+
+	bool flush();
+	QByteArray takeData();
+
+private:
+	template <typename T>
+	inline void write(T value);
+
+	void makeRoom(int len);
+	void writeBuffer();
+
+	QIODevice *mDevice;
+	QByteArray mBuffer;
+	char *mData;
+	qint64 mFlushed;
+	int mSize;
+	int mBlockSize;
+	bool mOk;
+};
+
+template <typename T>
+void BinaryWriter::write(T value)
+{
+	if (mBuffer.size() - mSize < int(sizeof(T)))
+		makeRoom(int(sizeof(T)));
+
+	qToLittleEndian(value, reinterpret_cast<uchar *>(mData + mSize));
+	mSize += int(sizeof(T));
+}
+
+BinaryWriter &BinaryWriter::operator<<(quint8 value)
+{
+	if (mBuffer.size() == mSize)
+		makeRoom(1);
+
+	mData[mSize++] = char(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(qint8 value)
+{
+	return *this << quint8(value);
+}
+
+BinaryWriter &BinaryWriter::operator<<(quint16 value)
+{
+	write(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(qint16 value)
+{
+	write(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(quint32 value)
+{
+	write(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(qint32 value)
+{
+	write(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(quint64 value)
+{
+	write(value);
+	return *this;
+}
+
+BinaryWriter &BinaryWriter::operator<<(qint64 value)
+{
+	write(value);
+	return *this;
+}
+
+void BinaryWriter::writeVarUInt(quint32 value)
+{
+	enum
+	{
+		MAX_VARINT_SIZE = 5
+	};
+
+	if (mBuffer.size() - mSize < MAX_VARINT_SIZE)
+		makeRoom(MAX_VARINT_SIZE);
+
+	while (value >= 0x80)
+	{
+		mData[mSize++] = char((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	mData[mSize++] = char(value);
+}
+
+void BinaryWriter::writeVarInt(qint32 value)
+{
+	writeVarUInt((quint32(value) << 1) ^ quint32(value >> 31));
+}
+
+bool BinaryWriter::ok() const
+{
+	return mOk;
+}
+
+qint64 BinaryWriter::pos() const
+{
+	return mFlushed + mSize;
+}
@@ -0,0 +1,129 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "BuildManifest.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <climits>
+
+BuildManifest::BuildManifest()
+	: inputSize(-1)
+	, inputModified(-1)
+{
+}
+
+QString BuildManifest::filePathForSAM(const QString &samFilePath)
+{
+	return samFilePath + ".manifest";
+}
+
+QString BuildManifest::toolVersion()
+{
+	return QStringLiteral("swf2sam " SWF2SAM_VERSION);
+}
+
+QByteArray BuildManifest::hashFile(const QString &filePath)
+{
+	QFile file(filePath);
+
+	if (not file.open(QFile::ReadOnly))
+		return QByteArray();
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+
+	auto size = file.size();
+	auto data = (size > 0 && size <= INT_MAX) ? file.map(0, size) : nullptr;
+
+	if (nullptr != data)
+	{
+		hash.addData(reinterpret_cast<const char *>(data), int(size));
+		file.unmap(data);
+	} else if (not hash.addData(&file))
+	{
+		return QByteArray();
+	}
+
+	return hash.result();
+}
+
+bool BuildManifest::load(const QString &filePath)
+{
+	QFile file(filePath);
+
+	if (not file.open(QFile::ReadOnly))
+		return false;
+
+	auto doc = QJsonDocument::fromJson(file.readAll());
+
+	if (not doc.isObject())
+		return false;
+
+	auto obj = doc.object();
+
+	tool = obj.value(QLatin1String("tool")).toString();
+	inputHash = QByteArray::fromHex(
+		obj.value(QLatin1String("input_sha1")).toString().toLatin1());
+	optionsHash = QByteArray::fromHex(
+		obj.value(QLatin1String("options_sha1")).toString().toLatin1());
+
+	// Qt JSON numbers are doubles, exact up to 2^53
+	inputSize = qint64(obj.value(QLatin1String("input_size")).toDouble(-1));
+	inputModified =
+		qint64(obj.value(QLatin1String("input_modified")).toDouble(-1));
+
+	outputs.clear();
+
+	for (auto value : obj.value(QLatin1String("outputs")).toArray())
+	{
+		outputs.append(value.toString());
+	}
+
+	return not tool.isEmpty() && not inputHash.isEmpty() &&
+		not optionsHash.isEmpty();
+}
+
+bool BuildManifest::save(const QString &filePath) const
+{
+	QJsonObject obj;
+	obj.insert("tool", tool);
+	obj.insert("input_sha1", QString::fromLatin1(inputHash.toHex()));
+	obj.insert("options_sha1", QString::fromLatin1(optionsHash.toHex()));
+	obj.insert("input_size", double(inputSize));
+	obj.insert("input_modified", double(inputModified));
+	obj.insert("outputs", QJsonArray::fromStringList(outputs));
+
+	QSaveFile file(filePath);
+
+	if (not file.open(QFile::WriteOnly | QFile::Truncate))
+		return false;
+
+	auto json = QJsonDocument(obj).toJson();
+
+	return file.write(json) == json.size() && file.commit();
+}
+
+bool BuildManifest::outputsExist(const QString &filePath) const
+{
+	if (outputs.isEmpty())
+		return false;
+
+	QDir dir(QFileInfo(filePath).path());
+
+	for (auto &output : outputs)
+	{
+		if (not QFileInfo::exists(dir.filePath(output)))
+			return false;
+	}
+
+	return true;
+}
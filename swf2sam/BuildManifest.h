@@ -0,0 +1,40 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Record of a finished conversion stored next to the SAM-file.
+// Conversion can be skipped while the input, the options and
+// the converter version match and all the outputs exist.
+class BuildManifest
+{
+public:
+	BuildManifest();
+
+	// Manifest is named after a SAM-file the conversion writes.
+	// With several scales it is the SAM-file of the largest scale.
+	static QString filePathForSAM(const QString &samFilePath);
+	static QString toolVersion();
+
+	// SHA-1 of the file contents, empty on read error
+	static QByteArray hashFile(const QString &filePath);
+
+	bool load(const QString &filePath);
+	bool save(const QString &filePath) const;
+
+	// Output paths are relative to the manifest directory
+	bool outputsExist(const QString &filePath) const;
+
+	QString tool;
+	QByteArray inputHash;
+	QByteArray optionsHash;
+	qint64 inputSize;
+	qint64 inputModified;
+	QStringList outputs;
+};
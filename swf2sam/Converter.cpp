@@ -7,12 +7,25 @@
 #include "Converter.h"
 
 #include "QIODeviceSWFReader.h"
+#include "MappedSWFReader.h"
+#include "StreamSWFReader.h"
+#include "PixelConversion.h"
+#include "ImageCache.h"
+#include "ImageDeduplicator.h"
+#include "Profiler.h"
+#include "BinaryWriter.h"
+#include "BuildManifest.h"
+#include "ConverterSink.h"
+#include "TextureAtlas.h"
+#include "JpegDecoder.h"
+#include "MemoryArena.h"
+#include "SegmentedDevice.h"
 
 #include "rfxswf.h"
 
 #include <QFile>
 #include <QSaveFile>
-#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -20,21 +33,51 @@
 #include <QVariant>
 #include <QtMath>
 #include <QImage>
+#include <QImageReader>
 #include <QSaveFile>
 #include <QBuffer>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QMutex>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 #include <zlib.h>
 
 #include <memory>
 #include <functional>
 #include <algorithm>
-#include <set>
-
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <tuple>
+
+// SAM version 3 is version 2 with:
+// - 32-bit frame count;
+// - keyframes, which replace the display list with adds and moves
+//   of all objects, at frames multiple of the keyframe interval;
+// - seek index after the last frame: frame count, keyframe interval,
+//   32-bit file offset of every frame, label count and pairs of
+//   label name and frame index;
+// - footer with 32-bit seek index offset and SAM_IndexSignature.
+// Playback from frame N starts at keyframe N - N % interval.
+//
+// SAM version 4 is version 3 with compact moves. Header name is
+// followed by 8-bit matrix precision P. Move transform and coordinates
+// are zigzag LEB128 deltas from the previous values of the depth,
+// or from identity matrix and zero coordinates for a new object.
+// Transform components are 16.16 fixed point values shifted right
+// by 16 - P bits with rounding.
+//
+// Any version can be wrapped in a compressed envelope,
+// see SAMCompressor.cpp.
 enum
 {
 	SAM_VERSION_1 = 1,
-	SAM_VERSION_2 = 2
+	SAM_VERSION_2 = 2,
+	SAM_VERSION_3 = 3,
+	SAM_VERSION_4 = 4
 };
 
 enum
@@ -51,7 +94,8 @@ enum
 	FRAMEFLAGS_REMOVES = 0x01,
 	FRAMEFLAGS_ADDS = 0x02,
 	FRAMEFLAGS_MOVES = 0x04,
-	FRAMEFLAGS_LABEL = 0x08
+	FRAMEFLAGS_LABEL = 0x08,
+	FRAMEFLAGS_KEYFRAME = 0x10
 };
 
 enum
@@ -59,7 +103,8 @@ enum
 	SYMBOLFLAGS_BITMAP = 0x01,
 	SYMBOLFLAGS_COLOR = 0x02,
 	SYMBOLFLAGS_MATRIX = 0x04,
-	SYMBOLFLAGS_SIZE = 0x08
+	SYMBOLFLAGS_SIZE = 0x08,
+	SYMBOLFLAGS_ATLAS = 0x10
 };
 
 enum
@@ -86,10 +131,30 @@ enum
 	DEPTHV2_MAX = DEPTHV2_MASK
 };
 
+// Change the version when exported image contents change.
+// Scaled IDCT output differs a bit from scaling decoded pixels,
+// so the JPEG decoder is a part of the version.
+// Used by image cache keys and build manifest options.
+static const QByteArray &imageVersion()
+{
+	static const QByteArray version = JpegDecoder::isAvailable()
+		? QByteArrayLiteral("swf2sam image 2 libjpeg")
+		: QByteArrayLiteral("swf2sam image 2");
+
+	return version;
+}
+
+static QString nameForScale(const QString &name, qreal scale)
+{
+	return QString("%1@%2x").arg(name, QString::number(scale));
+}
+
 static const char SAM_Signature[] = "MAS.";
+static const char SAM_IndexSignature[] = "MASI";
 enum
 {
-	SAM_SIGN_SIZE = sizeof(SAM_Signature) - 1
+	SAM_SIGN_SIZE = sizeof(SAM_Signature) - 1,
+	SAM_INDEX_SIGN_SIZE = sizeof(SAM_IndexSignature) - 1
 };
 
 struct SAM_Header
@@ -104,10 +169,22 @@ struct SAM_Header
 };
 
 Converter::Converter()
-	: mScale(1.0)
+	: mInputDevice(nullptr)
+	, mScale(1.0)
 	, mSamVersion(SAM_VERSION_2)
 	, mResult(OK)
 	, mSkipUnsupported(false)
+	, mStreaming(false)
+	, mAtlas(false)
+	, mIncremental(false)
+	, mTrustModificationTime(false)
+	, mSkipped(false)
+	, mBufferedLog(false)
+	, mAtlasPageSize(DEFAULT_ATLAS_PAGE_SIZE)
+	, mAtlasPadding(DEFAULT_ATLAS_PADDING)
+	, mAtlasExtrude(DEFAULT_ATLAS_EXTRUDE)
+	, mKeyframeInterval(DEFAULT_KEYFRAME_INTERVAL)
+	, mMatrixPrecision(DEFAULT_MATRIX_PRECISION)
 {
 }
 
@@ -130,6 +207,114 @@ void Converter::loadConfig(const QString &configFilePath)
 	loadConfigJson(file.readAll());
 }
 
+static bool loadImageEncoderConfig(
+	const QJsonObject &obj, ImageEncoder *encoder)
+{
+	auto format = obj.value(QLatin1String("image_format"));
+
+	if (not format.isUndefined())
+	{
+		ImageEncoder::Format value;
+
+		if (not ImageEncoder::parseFormat(format.toString(), &value))
+			return false;
+
+		encoder->setFormat(value);
+	}
+
+	auto level = obj.value(QLatin1String("png_compression"));
+
+	if (not level.isUndefined())
+	{
+		int value = level.toInt(ImageEncoder::MAX_LEVEL + 1);
+
+		if (not level.isDouble() || value < ImageEncoder::DEFAULT_LEVEL ||
+			value > ImageEncoder::MAX_LEVEL)
+		{
+			return false;
+		}
+
+		encoder->setCompressionLevel(value);
+	}
+
+	auto strategy = obj.value(QLatin1String("png_strategy"));
+
+	if (not strategy.isUndefined())
+	{
+		ImageEncoder::Strategy value;
+
+		if (not ImageEncoder::parseStrategy(strategy.toString(), &value))
+			return false;
+
+		encoder->setStrategy(value);
+	}
+
+	auto filter = obj.value(QLatin1String("png_filter"));
+
+	if (not filter.isUndefined())
+	{
+		ImageEncoder::Filter value;
+
+		if (not ImageEncoder::parseFilter(filter.toString(), &value))
+			return false;
+
+		encoder->setFilter(value);
+	}
+
+	return true;
+}
+
+static bool loadImageResamplerConfig(
+	const QJsonObject &obj, ImageResampler *resampler)
+{
+	auto filter = obj.value(QLatin1String("resample_filter"));
+
+	if (not filter.isUndefined())
+	{
+		ImageResampler::Filter value;
+
+		if (not ImageResampler::parseFilter(filter.toString(), &value))
+			return false;
+
+		resampler->setFilter(value);
+	}
+
+	return true;
+}
+
+static bool loadSamCompressorConfig(
+	const QJsonObject &obj, SAMCompressor *compressor)
+{
+	auto method = obj.value(QLatin1String("sam_compression"));
+
+	if (not method.isUndefined())
+	{
+		SAMCompressor::Method value;
+
+		if (not SAMCompressor::parseMethod(method.toString(), &value))
+			return false;
+
+		compressor->setMethod(value);
+	}
+
+	auto level = obj.value(QLatin1String("sam_compression_level"));
+
+	if (not level.isUndefined())
+	{
+		int value = level.toInt(SAMCompressor::MAX_ZSTD_LEVEL + 1);
+
+		if (not level.isDouble() || value < SAMCompressor::DEFAULT_LEVEL ||
+			value > SAMCompressor::MAX_ZSTD_LEVEL)
+		{
+			return false;
+		}
+
+		compressor->setCompressionLevel(value);
+	}
+
+	return true;
+}
+
 void Converter::loadConfigJson(const QByteArray &json)
 {
 	QJsonParseError error;
@@ -143,6 +328,22 @@ void Converter::loadConfigJson(const QByteArray &json)
 
 	auto obj = doc.object();
 
+	auto encoder = mImageEncoder;
+	auto resampler = mImageResampler;
+	auto compressor = mSamCompressor;
+
+	if (not loadImageEncoderConfig(obj, &encoder) ||
+		not loadImageResamplerConfig(obj, &resampler) ||
+		not loadSamCompressorConfig(obj, &compressor))
+	{
+		mResult = CONFIG_PARSE_ERROR;
+		return;
+	}
+
+	mImageEncoder = encoder;
+	mImageResampler = resampler;
+	mSamCompressor = compressor;
+
 	auto rename = obj.value(QLatin1String("rename_labels"));
 
 	if (not rename.isUndefined() and not rename.isObject())
@@ -197,37 +398,126 @@ void Converter::loadConfigJson(const QByteArray &json)
 	renameMap.swap(mLabelRenameMap);
 }
 
+// Informational lines of a conversion, printed at once or kept
+// until the conversion ends. Image export threads add lines concurrently.
+class ConversionLog
+{
+public:
+	explicit ConversionLog(bool buffered);
+
+	void info(const QString &line);
+	QStringList takeLines();
+
+private:
+	QMutex mMutex;
+	QStringList mLines;
+	bool mBuffered;
+};
+
+ConversionLog::ConversionLog(bool buffered)
+	: mBuffered(buffered)
+{
+}
+
+void ConversionLog::info(const QString &line)
+{
+	if (not mBuffered)
+	{
+		qInfo().noquote() << line;
+		return;
+	}
+
+	QMutexLocker lock(&mMutex);
+	mLines.append(line);
+}
+
+QStringList ConversionLog::takeLines()
+{
+	QMutexLocker lock(&mMutex);
+	QStringList result;
+	result.swap(mLines);
+	return result;
+}
+
+struct ImageExportOptions
+{
+	qreal scale;
+	const ImageEncoder *encoder;
+	const ImageResampler *resampler;
+	const ImageCache *cache;
+	ImageDeduplicator *deduplicator;
+	Profiler *profiler;
+	ConverterSink *sink;
+	ConversionLog *log;
+	int ownerId;
+
+	// Index in the multi-scale list, negative to decode from the tag
+	int scaleIndex;
+	bool keepPixels;
+
+	ImageExportOptions();
+};
+
 struct Image
 {
 	TAG *tag;
 	TAG *jpegTables;
 	size_t index;
+	size_t sourceIndex;
 	int width;
 	int height;
+	int atlasPage;
+	bool fileWritten;
 
 	QVariant errorInfo;
 
 	QString fileName;
 
-	QString filePathForPrefix(const QString &prefix) const;
+	// Output directory and file name, unique for profiling in batch mode
+	QString profileSubject;
+	QByteArray pixelKey;
+	QImage pixels;
+	QRect atlasRect;
+
+	// Multi-scale export keeps decoded pixels and per scale keys
+	QImage source;
+	QSize sourceSize;
+	std::vector<QByteArray> sourceCacheKeys;
+	std::vector<QByteArray> sourcePixelKeys;
+
+	QFuture<int> exportJob;
+
+	QString filePathForPrefix(
+		const QString &prefix, const QString &suffix) const;
 
 	Image(TAG *tag, TAG *jpegTables, size_t index);
 
 	int id() const;
 
-	int exportImage(const QString &prefix, qreal scale);
+	QByteArray cacheKey(const ImageExportOptions &options) const;
+	QByteArray deduplicationKey(const ImageExportOptions &options) const;
+	int decode(QImage *decoded, QSize *originalSize, qreal minScale,
+		Profiler *profiler);
+	int decodeSource(
+		const ImageExportOptions &options, const Converter::Scales &scales);
+	int exportImage(const QString &prefix, const ImageExportOptions &options);
+	void setFilePath(const QString &filePath);
+	void resetExport(const QString &filePath);
 };
 
 struct Shape
 {
+	using Vertices = ArenaVector<QPoint>;
+
 	int imageIndex;
-	QPolygon vertices;
+	Vertices vertices;
 	MATRIX matrix;
 	RGBA color;
 
-	Shape();
+	explicit Shape(MemoryArena *arena);
 
 	bool isRect() const;
+	QRect boundingRect() const;
 };
 
 struct ShapeRef
@@ -238,8 +528,20 @@ struct ShapeRef
 	size_t shapeCount() const;
 };
 
-struct Frame
+struct DepthRef
 {
+	size_t startDepth;
+	size_t endDepth;
+};
+
+// Parsed timeline stored as event streams shared by all frames.
+// Frames keep end offsets of their events in the streams.
+// Moves store only depth, flags and translation, other parts of the
+// matrix and color transforms are interned, since most animations
+// repeat them a lot.
+class Timeline
+{
+public:
 	struct ObjectAdd
 	{
 		quint16 depth;
@@ -257,26 +559,219 @@ struct Frame
 		ObjectMove();
 	};
 
-	struct DepthRef
+	// Event index ranges of one frame
+	struct Frame
+	{
+		size_t removeBegin;
+		size_t removeEnd;
+		size_t addBegin;
+		size_t addEnd;
+		size_t moveBegin;
+		size_t moveEnd;
+		QString labelName;
+	};
+
+	explicit Timeline(MemoryArena *arena);
+
+	void reset(size_t frameCount);
+
+	// Current frame is valid until ShowFrame of the last one
+	inline bool hasCurrentFrame() const;
+	void nextFrame();
+
+	void addRemove(quint16 depth);
+	void addObject(const ObjectAdd &add);
+	void addMove(const ObjectMove &move);
+	void setLabelName(const QString &labelName);
+
+	inline size_t frameCount() const;
+	Frame frame(size_t index) const;
+
+	inline size_t removeCount() const;
+	inline size_t addCount() const;
+	inline size_t moveCount() const;
+	size_t labelBytes() const;
+
+	inline quint16 removeDepth(size_t index) const;
+	ObjectAdd object(size_t index) const;
+	ObjectMove move(size_t index) const;
+
+private:
+	struct FrameEnd
+	{
+		quint32 removeEnd;
+		quint32 addEnd;
+		quint32 moveEnd;
+		qint32 labelIndex;
+	};
+
+	// Matrix without translation
+	struct LinearPart
 	{
-		size_t startDepth;
-		size_t endDepth;
+		SFIXED sx;
+		SFIXED r0;
+		SFIXED r1;
+		SFIXED sy;
+
+		bool operator<(const LinearPart &other) const;
 	};
 
-	using Removes = std::vector<quint16>;
-	using RemoveSet = std::set<quint16>;
-	using Adds = std::vector<ObjectAdd>;
-	using Moves = std::vector<ObjectMove>;
-	using MoveMap = std::map<int, Frame::ObjectMove>;
-	using DepthMap = std::map<int, DepthRef>;
+	FrameEnd frameEnd(size_t index) const;
+	static quint64 colorKey(const RGBA &multColor, const RGBA &addColor);
+
+	ArenaVector<FrameEnd> mFrames;
+
+	ArenaVector<quint16> mRemoveDepths;
+
+	ArenaVector<quint16> mAddDepths;
+	ArenaVector<quint16> mAddShapeIds;
 
-	QString labelName;
+	ArenaVector<quint16> mMoveDepths;
+	ArenaVector<quint16> mMoveFlags;
+	ArenaVector<SCOORD> mMoveX;
+	ArenaVector<SCOORD> mMoveY;
+	ArenaVector<quint32> mMoveLinearParts;
+	ArenaVector<quint32> mMoveColors;
 
-	Removes removes;
-	Adds adds;
-	Moves moves;
+	ArenaVector<LinearPart> mLinearParts;
+	ArenaMap<LinearPart, quint32> mLinearPartMap;
+	ArenaVector<quint64> mColors;
+	ArenaMap<quint64, quint32> mColorMap;
+
+	ArenaVector<QString> mLabelNames;
+
+	size_t mCurrentFrame;
+};
+
+bool Timeline::hasCurrentFrame() const
+{
+	return mCurrentFrame < mFrames.size();
+}
+
+size_t Timeline::frameCount() const
+{
+	return mFrames.size();
+}
+
+size_t Timeline::removeCount() const
+{
+	return mRemoveDepths.size();
+}
+
+size_t Timeline::addCount() const
+{
+	return mAddDepths.size();
+}
+
+size_t Timeline::moveCount() const
+{
+	return mMoveDepths.size();
+}
+
+quint16 Timeline::removeDepth(size_t index) const
+{
+	return mRemoveDepths[index];
+}
+
+// Dense table indexed by depth. Entries are valid only while their
+// generation matches the table one, so clear() does not touch memory.
+template <typename T>
+class DepthTable
+{
+public:
+	DepthTable();
+
+	void reset(size_t size);
+	void clear();
+
+	inline size_t size() const;
+
+	T *find(size_t depth);
+	T &insert(size_t depth);
+	void erase(size_t depth);
+
+private:
+	struct Entry
+	{
+		T value;
+		quint32 generation;
+
+		Entry();
+	};
+
+	std::vector<Entry> mEntries;
+	quint32 mGeneration;
 };
 
+template <typename T>
+DepthTable<T>::Entry::Entry()
+	: generation(0)
+{
+}
+
+template <typename T>
+DepthTable<T>::DepthTable()
+	: mGeneration(1)
+{
+}
+
+template <typename T>
+void DepthTable<T>::reset(size_t size)
+{
+	mEntries.assign(size, Entry());
+	mGeneration = 1;
+}
+
+template <typename T>
+void DepthTable<T>::clear()
+{
+	// Zero generation marks erased entries
+	if (++mGeneration == 0)
+		reset(mEntries.size());
+}
+
+template <typename T>
+size_t DepthTable<T>::size() const
+{
+	return mEntries.size();
+}
+
+template <typename T>
+T *DepthTable<T>::find(size_t depth)
+{
+	if (depth >= mEntries.size())
+		return nullptr;
+
+	auto &entry = mEntries[depth];
+
+	if (entry.generation != mGeneration)
+		return nullptr;
+
+	return &entry.value;
+}
+
+template <typename T>
+T &DepthTable<T>::insert(size_t depth)
+{
+	Q_ASSERT(depth < mEntries.size());
+	auto &entry = mEntries[depth];
+
+	if (entry.generation != mGeneration)
+	{
+		entry.value = T();
+		entry.generation = mGeneration;
+	}
+
+	return entry.value;
+}
+
+template <typename T>
+void DepthTable<T>::erase(size_t depth)
+{
+	if (depth < mEntries.size())
+		mEntries[depth].generation = 0;
+}
+
 static quint8 cxToByte(S16 cx, S16 cadd, double alpha)
 {
 	if (cx > 256)
@@ -295,6 +790,15 @@ static quint8 cxToByte(S16 cx, S16 cadd, double alpha)
 	return quint8(result * alpha);
 }
 
+// Rounds 16.16 fixed point value to shift less fraction bits
+static inline qint32 quantizeFixed(qint32 value, int shift)
+{
+	if (shift <= 0)
+		return value;
+
+	return qint32((qint64(value) + (qint64(1) << (shift - 1))) >> shift);
+}
+
 static inline quint8 addColorToByte(S16 cadd)
 {
 	if (cadd > 255)
@@ -308,41 +812,67 @@ static inline quint8 addColorToByte(S16 cadd)
 
 struct Converter::Process
 {
+	// Image export options point to the log from const methods
+	mutable ConversionLog log;
+
+	// Parsed timeline lives in the arena and is released all at once
+	MemoryArenaLease arenaLease;
+	std::unique_ptr<MappedSWFReader> mappedReader;
+	std::unique_ptr<ImageCache> imageCache;
 	SWF swf;
-	std::vector<Image> images;
-	std::vector<Shape> shapes;
-	std::vector<Frame> frames;
-	std::vector<ShapeRef> shapeRefs;
+	std::deque<Image> images;
+	std::vector<TAG *> retainedTags;
+	ArenaVector<Shape> shapes;
+	Timeline timeline;
+	ArenaVector<ShapeRef> shapeRefs;
 
-	std::map<int, size_t> imageMap;
-	std::map<int, size_t> shapeRefMap;
+	ArenaMap<int, size_t> imageMap;
+	ArenaMap<int, size_t> shapeRefMap;
 
 	LabelRenameMap renames;
+	Scales scales;
+	ArenaVector<int> shapeImages;
 
 	QString prefix;
+	QStringList outputs;
 	QVariant errorInfo;
 
 	Converter *owner;
-	Frame *currentFrame;
 	TAG *jpegTables;
+	size_t firstPendingImage;
+	qreal currentScale;
+	int ownerId;
 	int result;
 	quint16 firstDepth;
 	quint8 depthMultiplier;
+	bool multiScale;
+	bool inputOpened;
 
 	class SAMWriter
 	{
 		Process &owner;
-		QDataStream stream;
-		Frame::RemoveSet removes;
-		Frame::Adds adds;
-		Frame::Moves moves;
-		Frame::MoveMap moveMap;
-		Frame::DepthMap depthMap;
+		BinaryWriter stream;
+		std::vector<quint16> removes;
+		std::vector<Timeline::ObjectAdd> adds;
+		std::vector<Timeline::ObjectMove> moves;
+
+		// Indexed by output depth
+		DepthTable<bool> removeMarks;
+		DepthTable<bool> charMoveMarks;
+		DepthTable<Timeline::ObjectMove> moveMap;
+
+		// Indexed by input depth minus the first one
+		DepthTable<DepthRef> depthMap;
+
+		// Shape index by output depth, kept for keyframes
+		DepthTable<quint16> displayList;
+		std::vector<quint32> frameOffsets;
 
 	public:
 		SAMWriter(Process &owner, QIODevice *device);
 
 		bool exec();
+		QByteArray takeData();
 
 	private:
 		bool writeHeader();
@@ -350,32 +880,45 @@ struct Converter::Process
 		bool writeShapesV1();
 		bool writeShapesV2();
 		bool writeFrames();
+		bool writeKeyframe(const Timeline::Frame &frame);
+		bool writeSeekIndex();
+		bool isSeekable() const;
+		bool isKeyframe(size_t frameIndex) const;
 		bool writeString(const QString &str);
 		bool writeDisplayCount(size_t len);
 
-		bool prepareObjectRemoves(const Frame &frame);
+		DepthRef *findDepthRef(quint16 depth);
+
+		bool prepareObjectRemoves(const Timeline::Frame &frame);
 		bool writeObjectRemoves();
 
-		bool prepareObjectAdds(const Frame &frame);
+		bool prepareObjectAdds(const Timeline::Frame &frame);
 		bool writeObjectAdds();
 
-		bool prepareObjectMoves(const Frame &frame);
+		bool prepareObjectMoves(const Timeline::Frame &frame);
 		bool writeObjectMoves();
+		void applyObjectMoves();
+		void updateDisplayList();
+		static void resolveObjectMove(
+			Timeline::ObjectMove &move, const Timeline::ObjectMove &prev);
 		bool writeObjectMoveV1(
-			Frame::ObjectMove &move, const Frame::ObjectMove &prev);
+			Timeline::ObjectMove &move, const Timeline::ObjectMove &prev);
 		bool writeObjectMoveV2(
-			Frame::ObjectMove &move, const Frame::ObjectMove &prev);
-		bool writeFrameLabel(const Frame &frame);
-		bool writeFrameFlags(const Frame &frame);
+			Timeline::ObjectMove &move, const Timeline::ObjectMove &prev);
+		bool writeObjectMoveV4(
+			Timeline::ObjectMove &move, const Timeline::ObjectMove &prev);
+		bool writeFrameLabel(const Timeline::Frame &frame);
+		bool writeFrameFlags(const Timeline::Frame &frame, bool keyframe);
 		bool writeFrameCount();
 
 		bool outputStreamOk();
+		int estimatedSize() const;
 	};
 
 	Process(Converter *owner);
 	~Process();
 
-	inline int scale(int value, int mode) const;
+	int scale(int value, int mode) const;
 	size_t maxDisplayCount() const;
 	size_t maxDepth() const;
 	size_t maxShape() const;
@@ -384,15 +927,32 @@ struct Converter::Process
 	bool handleFrameLabel(TAG *tag);
 	bool handlePlaceObject(TAG *tag);
 	bool handleRemoveObject(TAG *tag);
+	QString prefixForScale(qreal scale) const;
+	QString imagePrefix() const;
+	ImageExportOptions imageExportOptions() const;
 	bool handleImage(TAG *tag);
 	bool handleShape(TAG *tag);
+	QIODevice *openInput(QFile &file, QBuffer &buffer);
+	void closeInput(QIODevice *device);
 	bool readSWF();
 	bool parseSWF();
+	bool streamSWF();
+	void prepareFrames();
+	bool handleTag(TAG *tag);
+	bool waitForImages();
+	bool exportScale(size_t scaleIndex);
+	bool exportScaledImages(size_t scaleIndex);
+	void deduplicateImages();
+	bool packAtlas();
 	bool exportSAM();
+	bool writeSAMFile(const QString &filePath);
+	bool writeSAMToSink(const QString &name);
+	bool writeSAMData(const QString &fileName, QByteArray *data);
 };
 
-Shape::Shape()
+Shape::Shape(MemoryArena *arena)
 	: imageIndex(-1)
+	, vertices(arena)
 {
 	memset(&matrix, 0, sizeof(matrix));
 	memset(&color, 0, sizeof(color));
@@ -402,12 +962,12 @@ Shape::Shape()
 
 bool Shape::isRect() const
 {
-	if (vertices.isEmpty())
+	if (vertices.empty())
 		return false;
 
-	int vertexCount = 4 + ((vertices.first() == vertices.last()) ? 1 : 0);
+	size_t vertexCount = 4 + ((vertices.front() == vertices.back()) ? 1 : 0);
 
-	if (vertexCount != vertices.count())
+	if (vertexCount != vertices.size())
 		return false;
 
 	auto &p1 = vertices.at(0);
@@ -418,80 +978,482 @@ bool Shape::isRect() const
 	return (p1 - p2 == p4 - p3) && (p4 - p1 == p3 - p2);
 }
 
-size_t ShapeRef::shapeCount() const
+QRect Shape::boundingRect() const
 {
-	if (endIndex < startIndex)
-		return 0;
+	// Same as QPolygon::boundingRect()
+	if (vertices.empty())
+		return QRect(0, 0, 0, 0);
 
-	return (endIndex - startIndex) + 1;
+	QPoint topLeft = vertices.front();
+	QPoint bottomRight = topLeft;
+
+	for (const QPoint &p : vertices)
+	{
+		topLeft.setX(qMin(topLeft.x(), p.x()));
+		topLeft.setY(qMin(topLeft.y(), p.y()));
+		bottomRight.setX(qMax(bottomRight.x(), p.x()));
+		bottomRight.setY(qMax(bottomRight.y(), p.y()));
+	}
+
+	return QRect(topLeft, bottomRight);
 }
 
-int Converter::exec()
+Timeline::Timeline(MemoryArena *arena)
+	: mFrames(arena)
+	, mRemoveDepths(arena)
+	, mAddDepths(arena)
+	, mAddShapeIds(arena)
+	, mMoveDepths(arena)
+	, mMoveFlags(arena)
+	, mMoveX(arena)
+	, mMoveY(arena)
+	, mMoveLinearParts(arena)
+	, mMoveColors(arena)
+	, mLinearParts(arena)
+	, mLinearPartMap(arena)
+	, mColors(arena)
+	, mColorMap(arena)
+	, mLabelNames(arena)
+	, mCurrentFrame(0)
 {
-	mWarnings.clear();
-	Process process(this);
-	mResult = process.result;
-	mErrorInfo = process.errorInfo;
-	return mResult;
 }
 
-QString Converter::tagName(const QVariant &t)
+void Timeline::reset(size_t frameCount)
 {
-	return tagName(quint16(t.toUInt()));
+	FrameEnd end;
+	end.removeEnd = 0;
+	end.addEnd = 0;
+	end.moveEnd = 0;
+	end.labelIndex = -1;
+
+	mFrames.assign(frameCount, end);
+	mCurrentFrame = 0;
 }
 
-QString Converter::tagName(quint16 t)
+void Timeline::nextFrame()
 {
-	TAG tag;
-	tag.id = t;
-	QString tagName(swf_TagGetName(&tag));
+	Q_ASSERT(hasCurrentFrame());
 
-	if (tagName.isEmpty())
-		tagName = QString::number(tag.id);
+	auto &end = mFrames[mCurrentFrame++];
+	end.removeEnd = quint32(mRemoveDepths.size());
+	end.addEnd = quint32(mAddDepths.size());
+	end.moveEnd = quint32(mMoveDepths.size());
+}
 
-	return tagName;
+void Timeline::addRemove(quint16 depth)
+{
+	Q_ASSERT(hasCurrentFrame());
+	mRemoveDepths.push_back(depth);
 }
 
-QString Converter::fillStyleToStr(int value)
+void Timeline::addObject(const ObjectAdd &add)
 {
-	switch (value)
-	{
-		case 0x00:
-			return "SOLID";
+	Q_ASSERT(hasCurrentFrame());
+	mAddDepths.push_back(add.depth);
+	mAddShapeIds.push_back(add.shapeId);
+}
 
-		case 0x10:
-		case 0x11:
-			return "LINEAR_GRADIENT";
+void Timeline::addMove(const ObjectMove &move)
+{
+	Q_ASSERT(hasCurrentFrame());
 
-		case 0x12:
-		case 0x13:
-			return "RADIAL_GRADIENT";
+	LinearPart linear;
+	linear.sx = move.matrix.sx;
+	linear.r0 = move.matrix.r0;
+	linear.r1 = move.matrix.r1;
+	linear.sy = move.matrix.sy;
 
-		case 0x40:
-		case 0x41:
-		case 0x42:
-		case 0x43:
-			return "BITMAP";
+	auto linearIt = mLinearPartMap.find(linear);
 
-		default:
-			break;
+	if (linearIt == mLinearPartMap.end())
+	{
+		linearIt = mLinearPartMap
+					   .insert(std::make_pair(
+						   linear, quint32(mLinearParts.size())))
+					   .first;
+		mLinearParts.push_back(linear);
 	}
 
-	return QString("0x%1").arg(value, 2, 16, QChar('0'));
-}
+	auto color = colorKey(move.multColor, move.addColor);
+	auto colorIt = mColorMap.find(color);
 
-QString Converter::warnMessage(const Warning &warn)
-{
-	switch (warn.code)
+	if (colorIt == mColorMap.end())
 	{
-		case INPUT_FILE_OPEN_ERROR:
-			return "Unable to open SWF file.";
+		colorIt = mColorMap
+					  .insert(std::make_pair(color, quint32(mColors.size())))
+					  .first;
+		mColors.push_back(color);
+	}
 
-		case INPUT_FILE_FORMAT_ERROR:
-			return "SWF file format error.";
+	mMoveDepths.push_back(move.depth);
+	mMoveFlags.push_back(move.flags);
+	mMoveX.push_back(move.matrix.tx);
+	mMoveY.push_back(move.matrix.ty);
+	mMoveLinearParts.push_back(linearIt->second);
+	mMoveColors.push_back(colorIt->second);
+}
 
-		case INPUT_FILE_BAD_DATA_ERROR:
-			return QString("Broken SWF file (%1).").arg(warn.info.toString());
+void Timeline::setLabelName(const QString &labelName)
+{
+	Q_ASSERT(hasCurrentFrame());
+	auto &end = mFrames[mCurrentFrame];
+
+	if (end.labelIndex >= 0)
+	{
+		mLabelNames[size_t(end.labelIndex)] = labelName;
+		return;
+	}
+
+	end.labelIndex = qint32(mLabelNames.size());
+	mLabelNames.push_back(labelName);
+}
+
+Timeline::Frame Timeline::frame(size_t index) const
+{
+	Q_ASSERT(index < mFrames.size());
+
+	Frame result;
+
+	auto end = frameEnd(index);
+	result.removeEnd = end.removeEnd;
+	result.addEnd = end.addEnd;
+	result.moveEnd = end.moveEnd;
+
+	if (index > 0)
+	{
+		auto begin = frameEnd(index - 1);
+		result.removeBegin = begin.removeEnd;
+		result.addBegin = begin.addEnd;
+		result.moveBegin = begin.moveEnd;
+	} else
+	{
+		result.removeBegin = 0;
+		result.addBegin = 0;
+		result.moveBegin = 0;
+	}
+
+	if (end.labelIndex >= 0)
+		result.labelName = mLabelNames[size_t(end.labelIndex)];
+
+	return result;
+}
+
+Timeline::FrameEnd Timeline::frameEnd(size_t index) const
+{
+	auto end = mFrames[index];
+
+	// Events of the current frame are at the end of the streams,
+	// frames after it have no events yet
+	if (index >= mCurrentFrame)
+	{
+		end.removeEnd = quint32(mRemoveDepths.size());
+		end.addEnd = quint32(mAddDepths.size());
+		end.moveEnd = quint32(mMoveDepths.size());
+	}
+
+	return end;
+}
+
+size_t Timeline::labelBytes() const
+{
+	size_t result = 0;
+
+	for (auto &labelName : mLabelNames)
+		result += size_t(labelName.size());
+
+	return result;
+}
+
+Timeline::ObjectAdd Timeline::object(size_t index) const
+{
+	ObjectAdd result;
+	result.depth = mAddDepths[index];
+	result.shapeId = mAddShapeIds[index];
+	return result;
+}
+
+Timeline::ObjectMove Timeline::move(size_t index) const
+{
+	ObjectMove result;
+	result.depth = mMoveDepths[index];
+	result.flags = mMoveFlags[index];
+
+	auto &linear = mLinearParts[mMoveLinearParts[index]];
+	result.matrix.sx = linear.sx;
+	result.matrix.r0 = linear.r0;
+	result.matrix.r1 = linear.r1;
+	result.matrix.sy = linear.sy;
+	result.matrix.tx = mMoveX[index];
+	result.matrix.ty = mMoveY[index];
+
+	auto color = mColors[mMoveColors[index]];
+	auto multColor = quint32(color >> 32);
+	auto addColor = quint32(color);
+	memcpy(&result.multColor, &multColor, sizeof(RGBA));
+	memcpy(&result.addColor, &addColor, sizeof(RGBA));
+
+	return result;
+}
+
+bool Timeline::LinearPart::operator<(const LinearPart &other) const
+{
+	return std::tie(sx, r0, r1, sy) <
+		std::tie(other.sx, other.r0, other.r1, other.sy);
+}
+
+quint64 Timeline::colorKey(const RGBA &multColor, const RGBA &addColor)
+{
+	static_assert(sizeof(RGBA) == sizeof(quint32), "Unexpected RGBA size");
+
+	quint32 mult;
+	quint32 add;
+	memcpy(&mult, &multColor, sizeof(RGBA));
+	memcpy(&add, &addColor, sizeof(RGBA));
+
+	return (quint64(mult) << 32) | add;
+}
+
+size_t ShapeRef::shapeCount() const
+{
+	if (endIndex < startIndex)
+		return 0;
+
+	return (endIndex - startIndex) + 1;
+}
+
+int Converter::exec()
+{
+	mWarnings.clear();
+	mLog.clear();
+	mSkipped = false;
+
+	bool incremental = mIncremental && mInputData.isEmpty() &&
+		nullptr == mInputDevice && not mSink;
+
+	BuildManifest manifest;
+
+	if (incremental && upToDate(&manifest))
+	{
+		mSkipped = true;
+		mResult = OK;
+		mErrorInfo.clear();
+
+		ConversionLog log(mBufferedLog);
+		log.info(QString("%1 is up to date.")
+					 .arg(QFileInfo(mInputFilePath).fileName()));
+		mLog = log.takeLines();
+		return mResult;
+	}
+
+	QStringList outputs;
+
+	{
+		Process process(this);
+		mResult = process.result;
+		mErrorInfo = process.errorInfo;
+		mLog = process.log.takeLines();
+		outputs = process.outputs;
+	}
+
+	if (incremental && mResult == OK)
+		saveManifest(manifest, outputs);
+
+	return mResult;
+}
+
+QString Converter::samFilePath() const
+{
+	auto name = QFileInfo(mInputFilePath).baseName();
+
+	// Without a single scale output the manifest goes next to
+	// the largest scale, which is exported first
+	if (not mScales.empty())
+	{
+		name = nameForScale(
+			name, *std::max_element(mScales.begin(), mScales.end()));
+	}
+
+	return outputFilePath(name) + ".sam";
+}
+
+QByteArray Converter::optionsHash() const
+{
+	// Everything affecting output files
+	QStringList options;
+	options.append(QString::number(mScale, 'g', 17));
+
+	for (qreal scale : mScales)
+	{
+		options.append(QString("scale:%1").arg(scale, 0, 'g', 17));
+	}
+
+	options.append(QString::number(mSamVersion));
+
+	if (mSamVersion >= SAM_VERSION_3)
+		options.append(QString("keyframes:%1").arg(mKeyframeInterval));
+
+	if (mSamVersion >= SAM_VERSION_4)
+		options.append(QString("precision:%1").arg(mMatrixPrecision));
+
+	if (mSamCompressor.isEnabled())
+	{
+		options.append(QString("samz:%1").arg(
+			QString::fromLatin1(mSamCompressor.key())));
+	}
+	options.append(QString::number(int(mSkipUnsupported)));
+	options.append(QString::fromLatin1(imageVersion()));
+	options.append(QString::fromLatin1(mImageEncoder.key()));
+	options.append(QString::fromLatin1(
+		ImageResampler::filterName(mImageResampler.filter())));
+	options.append(QString::number(int(bool(mImageDeduplicator))));
+
+	if (mAtlas)
+	{
+		options.append(QString("atlas:%1:%2:%3")
+						   .arg(mAtlasPageSize)
+						   .arg(mAtlasPadding)
+						   .arg(mAtlasExtrude));
+	}
+
+	for (auto &it : mLabelRenameMap)
+	{
+		options.append(it.first);
+		options.append(it.second);
+	}
+
+	return QCryptographicHash::hash(
+		options.join('\n').toUtf8(), QCryptographicHash::Sha1);
+}
+
+bool Converter::upToDate(BuildManifest *current) const
+{
+	QFileInfo inputInfo(mInputFilePath);
+
+	if (not inputInfo.isFile())
+		return false;
+
+	current->tool = BuildManifest::toolVersion();
+	current->optionsHash = optionsHash();
+	current->inputSize = inputInfo.size();
+	current->inputModified = inputInfo.lastModified().toMSecsSinceEpoch();
+
+	auto manifestFilePath = BuildManifest::filePathForSAM(samFilePath());
+
+	BuildManifest stored;
+
+	bool valid = stored.load(manifestFilePath) &&
+		stored.tool == current->tool &&
+		stored.optionsHash == current->optionsHash &&
+		stored.outputsExist(manifestFilePath);
+
+	bool sameStat = stored.inputSize == current->inputSize &&
+		stored.inputModified == current->inputModified;
+
+	if (valid && sameStat && mTrustModificationTime)
+	{
+		current->inputHash = stored.inputHash;
+		return true;
+	}
+
+	current->inputHash = BuildManifest::hashFile(mInputFilePath);
+
+	if (not valid || current->inputHash.isEmpty() ||
+		current->inputHash != stored.inputHash)
+	{
+		return false;
+	}
+
+	// Input was touched but not changed, refresh it for the fast path
+	if (not sameStat)
+	{
+		current->outputs = stored.outputs;
+		current->save(manifestFilePath);
+	}
+
+	return true;
+}
+
+void Converter::saveManifest(BuildManifest &manifest, const QStringList &outputs)
+{
+	auto manifestFilePath = BuildManifest::filePathForSAM(samFilePath());
+	QDir manifestDir(QFileInfo(manifestFilePath).path());
+
+	manifest.outputs.clear();
+
+	for (auto &output : outputs)
+	{
+		manifest.outputs.append(manifestDir.relativeFilePath(output));
+	}
+
+	// Input was not hashed only if it was not a regular file before
+	if (manifest.inputHash.isEmpty())
+		manifest.inputHash = BuildManifest::hashFile(mInputFilePath);
+
+	// A missing manifest only costs a conversion next time
+	if (not manifest.save(manifestFilePath))
+	{
+		qWarning().noquote()
+			<< QString("Unable to write '%1'.").arg(manifestFilePath);
+	}
+}
+
+QString Converter::tagName(const QVariant &t)
+{
+	return tagName(quint16(t.toUInt()));
+}
+
+QString Converter::tagName(quint16 t)
+{
+	TAG tag;
+	tag.id = t;
+	QString tagName(swf_TagGetName(&tag));
+
+	if (tagName.isEmpty())
+		tagName = QString::number(tag.id);
+
+	return tagName;
+}
+
+QString Converter::fillStyleToStr(int value)
+{
+	switch (value)
+	{
+		case 0x00:
+			return "SOLID";
+
+		case 0x10:
+		case 0x11:
+			return "LINEAR_GRADIENT";
+
+		case 0x12:
+		case 0x13:
+			return "RADIAL_GRADIENT";
+
+		case 0x40:
+		case 0x41:
+		case 0x42:
+		case 0x43:
+			return "BITMAP";
+
+		default:
+			break;
+	}
+
+	return QString("0x%1").arg(value, 2, 16, QChar('0'));
+}
+
+QString Converter::warnMessage(const Warning &warn)
+{
+	switch (warn.code)
+	{
+		case INPUT_FILE_OPEN_ERROR:
+			return "Unable to open SWF file.";
+
+		case INPUT_FILE_FORMAT_ERROR:
+			return "SWF file format error.";
+
+		case INPUT_FILE_BAD_DATA_ERROR:
+			return QString("Broken SWF file (%1).").arg(warn.info.toString());
 
 		case UNSUPPORTED_LINESTYLES:
 			return "Cannot export line styles to SAM.";
@@ -561,6 +1523,25 @@ QString Converter::warnMessage(const Warning &warn)
 
 		case BAD_SCALE_VALUE:
 			return "Bad scale value.";
+
+		case UNSUPPORTED_ATLAS:
+			return "Texture atlas requires SAM version 2.";
+
+		case BAD_ATLAS_OPTIONS:
+			return "Bad texture atlas page size, padding or extrusion.";
+
+		case BAD_KEYFRAME_INTERVAL:
+			return "Keyframe interval should be from 0 to 65535.";
+
+		case BAD_MATRIX_PRECISION:
+			return "Matrix precision should be from 0 to 16 bits.";
+
+		case BAD_SAM_COMPRESSION:
+			return "Unsupported SAM compression method or level.";
+
+		case ATLAS_IMAGE_TOO_LARGE:
+			return QString("Image '%1' does not fit into texture atlas page.")
+				.arg(warn.info.toString());
 	}
 
 	return QString();
@@ -598,36 +1579,29 @@ QString Converter::outputFilePath(const QString &fileName) const
 	return outDir.filePath(fileName);
 }
 
-int Converter::scale(int value, int mode) const
+static QString imageFilePath(
+	const QString &prefix, size_t index, const QString &suffix)
 {
-	qreal v = value * mScale;
-
-	switch (mode)
-	{
-		case FLOOR:
-			return qFloor(v);
-
-		case CEIL:
-			return qCeil(v);
+	static const QString nameFmt("%1%2.%3");
 
-		default:
-			break;
-	}
-
-	return int(v);
+	return nameFmt.arg(prefix).arg(index, 4, 10, QChar('0')).arg(suffix);
 }
 
-QString Image::filePathForPrefix(const QString &prefix) const
+QString Image::filePathForPrefix(
+	const QString &prefix, const QString &suffix) const
 {
-	static const QString nameFmt("%1%2.png");
-
-	return nameFmt.arg(prefix).arg(index, 4, 10, QChar('0'));
+	return imageFilePath(prefix, index, suffix);
 }
 
 Image::Image(TAG *tag, TAG *jpegTables, size_t index)
 	: tag(tag)
 	, jpegTables(jpegTables)
 	, index(index)
+	, sourceIndex(index)
+	, width(0)
+	, height(0)
+	, atlasPage(-1)
+	, fileWritten(false)
 {
 	Q_ASSERT(nullptr != tag);
 }
@@ -637,21 +1611,57 @@ int Image::id() const
 	return GET16(tag->data);
 }
 
-static int findjpegboundary(U8 *data, int len)
+void Image::setFilePath(const QString &filePath)
+{
+	QFileInfo fileInfo(filePath);
+	fileName = fileInfo.fileName();
+	profileSubject =
+		QFileInfo(fileInfo.path()).fileName() + QLatin1Char('/') + fileName;
+}
+
+void Image::resetExport(const QString &filePath)
+{
+	setFilePath(filePath);
+	sourceIndex = index;
+	width = 0;
+	height = 0;
+	atlasPage = -1;
+	fileWritten = false;
+	errorInfo.clear();
+	pixelKey.clear();
+	pixels = QImage();
+	atlasRect = QRect();
+}
+
+// Position of the first EOI and SOI marker pair. SWF-files produced
+// by some tools store JPEG tables and image as separate JPEG streams.
+static int findjpegboundary(const U8 *data, int len)
 {
-	int t;
-	int pos = -1;
+	if (len < 4)
+		return -1;
+
+	auto begin = reinterpret_cast<const char *>(data);
+	auto p = begin;
+	auto end = begin + len - 3;
 
-	for (t = 0; t < len - 4; t++)
+	// memchr is vectorized by C runtime and skips entropy-coded data fast
+	while (p < end)
 	{
-		if (data[t] == 0xff && data[t + 1] == 0xd9 && data[t + 2] == 0xff &&
-			data[t + 3] == 0xd8)
+		p = static_cast<const char *>(memchr(p, 0xFF, size_t(end - p)));
+
+		if (nullptr == p)
+			break;
+
+		if (quint8(p[1]) == 0xD9 && quint8(p[2]) == 0xFF &&
+			quint8(p[3]) == 0xD8)
 		{
-			pos = t;
+			return int(p - begin);
 		}
+
+		p++;
 	}
 
-	return pos;
+	return -1;
 }
 
 static QByteArray tagInflate(TAG *t, int len)
@@ -671,16 +1681,127 @@ static QByteArray tagInflate(TAG *t, int len)
 	return result;
 }
 
-int Image::exportImage(const QString &prefix, qreal scale)
+static int saveImageFile(
+	ConverterSink *sink, const QString &filePath, const QByteArray &data)
+{
+	if (nullptr != sink)
+		return sink->writeImage(filePath, data);
+
+	return FileConverterSink::saveFile(filePath, data);
+}
+
+// Halves the image while it is at least twice larger than the requested
+// size, then smoothly scales the last level to that size. The source is
+// replaced with the last level, so following smaller sizes continue
+// the same chain of halved levels as if they started from the original.
+// Pixels differ from scaling the original directly, so multi-scale
+// images have own cache keys.
+static QImage mipScaled(const ImageResampler &resampler, QImage *source,
+	int width, int height)
+{
+	QImage level = *source;
+
+	while (level.width() >= width * 2 && level.height() >= height * 2)
+	{
+		level = resampler.scaled(
+			level, (level.width() + 1) / 2, (level.height() + 1) / 2);
+	}
+
+	*source = level;
+
+	if (level.width() == width && level.height() == height)
+		return level;
+
+	return resampler.scaled(level, width, height);
+}
+
+// Shared by all conversions running in this process, so batch mode
+// does not multiply the number of image encoding threads
+Q_GLOBAL_STATIC(QThreadPool, imageThreadPool)
+
+ImageExportOptions::ImageExportOptions()
+	: scale(1.0)
+	, encoder(nullptr)
+	, resampler(nullptr)
+	, cache(nullptr)
+	, deduplicator(nullptr)
+	, profiler(nullptr)
+	, sink(nullptr)
+	, log(nullptr)
+	, ownerId(0)
+	, scaleIndex(-1)
+	, keepPixels(false)
+{
+}
+
+QByteArray Image::cacheKey(const ImageExportOptions &options) const
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+
+	auto &version = imageVersion();
+	hash.addData(version.constData(), version.size() + 1);
+
+	// Character id is not hashed to share entries
+	// between equal bitmaps with different ids
+	auto tagId = QByteArray::number(tag->id);
+	hash.addData(tagId.constData(), tagId.size() + 1);
+
+	if (tag->len > 2)
+	{
+		hash.addData(
+			reinterpret_cast<const char *>(&tag->data[2]), int(tag->len - 2));
+	}
+
+	if (tag->id == ST_DEFINEBITSJPEG && nullptr != jpegTables &&
+		jpegTables->len > 0)
+	{
+		hash.addData(reinterpret_cast<const char *>(jpegTables->data),
+			int(jpegTables->len));
+	}
+
+	hash.addData(QByteArray::number(options.scale, 'g', 17));
+	hash.addData(options.encoder->key());
+
+	// Multi-scale images are made by mipScaled()
+	if (options.scaleIndex >= 0)
+		hash.addData("mip");
+
+	// Qt scaling keeps keys of images cached before other filters
+	auto filter = options.resampler->filter();
+
+	if (filter != ImageResampler::FILTER_QT)
+		hash.addData(ImageResampler::filterName(filter));
+
+	return hash.result();
+}
+
+QByteArray Image::deduplicationKey(const ImageExportOptions &options) const
 {
-	auto imageFilePath = filePathForPrefix(prefix);
+	// Conversions sharing the deduplicator may encode or scale
+	// equal pixels differently, like daemon jobs with own config
+	auto key = pixelKey;
+	key.append(options.encoder->key());
+	key.append(':');
+	key.append(ImageResampler::filterName(options.resampler->filter()));
+
+	if (options.scaleIndex >= 0)
+		key.append(":mip");
 
-	fileName = QFileInfo(imageFilePath).fileName();
+	return key;
+}
+
+int Image::decode(
+	QImage *decoded, QSize *originalSize, qreal minScale, Profiler *profiler)
+{
+	Q_ASSERT(nullptr != decoded);
+	Q_ASSERT(nullptr != originalSize);
+	QImage &image = *decoded;
 
 	int writeLen;
 	int tagEnd = tag->len;
 
-	QImage image;
+	Profiler::Scope decodeScope(profiler, "image.decode", profileSubject);
+	decodeScope.setBytes(tagEnd);
 
 	switch (tag->id)
 	{
@@ -691,9 +1812,8 @@ int Image::exportImage(const QString &prefix, qreal scale)
 		case ST_DEFINEBITSJPEG:
 		case ST_DEFINEBITSJPEG2:
 		{
-			QBuffer jpegBuffer;
-
-			jpegBuffer.open(QBuffer::WriteOnly);
+			// Tables and image data are read in place by the decoder
+			SegmentedDevice jpegDevice;
 
 			int skip = 2;
 
@@ -706,12 +1826,9 @@ int Image::exportImage(const QString &prefix, qreal scale)
 						writeLen = jpegTables->len - 2;
 						skip += 2;
 
-						if (jpegBuffer.write(
-								reinterpret_cast<char *>(jpegTables->data),
-								writeLen) != writeLen)
-						{
-							return Converter::OUTPUT_FILE_WRITE_ERROR;
-						}
+						jpegDevice.addSegment(
+							reinterpret_cast<char *>(jpegTables->data),
+							writeLen);
 					}
 
 					break;
@@ -723,14 +1840,8 @@ int Image::exportImage(const QString &prefix, qreal scale)
 
 					if (pos >= 0)
 					{
-						writeLen = pos;
-
-						if (jpegBuffer.write(
-								reinterpret_cast<char *>(&tag->data[2]),
-								writeLen) != writeLen)
-						{
-							return Converter::OUTPUT_FILE_WRITE_ERROR;
-						}
+						jpegDevice.addSegment(
+							reinterpret_cast<char *>(&tag->data[2]), pos);
 
 						skip += pos + 4;
 					}
@@ -741,20 +1852,23 @@ int Image::exportImage(const QString &prefix, qreal scale)
 
 			writeLen = tagEnd - skip;
 
-			if (writeLen > 0 &&
-				jpegBuffer.write(reinterpret_cast<char *>(&tag->data[skip]),
-					writeLen) != writeLen)
+			if (writeLen > 0)
 			{
-				return Converter::OUTPUT_FILE_WRITE_ERROR;
+				jpegDevice.addSegment(
+					reinterpret_cast<char *>(&tag->data[skip]), writeLen);
 			}
 
-			jpegBuffer.close();
+			if (JpegDecoder::decode(jpegDevice, minScale,
+					QImage::Format_RGBX8888, &image, originalSize))
+			{
+				break;
+			}
 
-			auto &bytes = jpegBuffer.buffer();
+			jpegDevice.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 
-			image = QImage::fromData(
-				reinterpret_cast<const quint8 *>(bytes.constData()),
-				bytes.count());
+			// Format is detected, DefineBitsJPEG2 may also contain PNG or GIF
+			QImageReader reader(&jpegDevice);
+			image = reader.read();
 
 			if (image.isNull())
 			{
@@ -762,6 +1876,7 @@ int Image::exportImage(const QString &prefix, qreal scale)
 				return Converter::INPUT_FILE_BAD_DATA_ERROR;
 			}
 
+			*originalSize = image.size();
 			break;
 		}
 
@@ -770,21 +1885,37 @@ int Image::exportImage(const QString &prefix, qreal scale)
 			if (tagEnd > 6)
 			{
 				int end = GET32(&tag->data[2]);
+				int compressedAlphaSize = tagEnd - 6 - end;
 
-				image = QImage::fromData(&tag->data[6], end);
+				SegmentedDevice jpegDevice;
+				jpegDevice.addSegment(
+					reinterpret_cast<char *>(&tag->data[6]), end);
 
-				if (image.isNull())
+				// Alpha plane is stored at full size
+				if (not JpegDecoder::decode(jpegDevice,
+						compressedAlphaSize > 0 ? 1.0 : minScale,
+						QImage::Format_RGBX8888, &image, originalSize))
 				{
-					errorInfo = QString("Jpeg load failed");
-					return Converter::INPUT_FILE_BAD_DATA_ERROR;
+					image = QImage::fromData(&tag->data[6], end);
+
+					if (image.isNull())
+					{
+						errorInfo = QString("Jpeg load failed");
+						return Converter::INPUT_FILE_BAD_DATA_ERROR;
+					}
+
+					*originalSize = image.size();
 				}
 
 				end += 6;
 
-				int compressedAlphaSize = tagEnd - end;
-
 				if (compressedAlphaSize > 0 && not image.hasAlphaChannel())
 				{
+					decodeScope.finish();
+					Profiler::Scope alphaScope(
+						profiler, "image.alpha", profileSubject);
+					alphaScope.setBytes(compressedAlphaSize);
+
 					int width = image.width();
 					int height = image.height();
 
@@ -813,13 +1944,9 @@ int Image::exportImage(const QString &prefix, qreal scale)
 
 					for (int y = 0; y < height; y++)
 					{
-						auto dstAlpha = image.scanLine(y) + 3;
-
-						for (int x = 0; x < width; x++)
-						{
-							*dstAlpha = *srcAlpha++;
-							dstAlpha += 4;
-						}
+						PixelConversion::mergeAlpha(
+							image.scanLine(y), srcAlpha, width);
+						srcAlpha += width;
 					}
 				}
 			}
@@ -900,53 +2027,134 @@ int Image::exportImage(const QString &prefix, qreal scale)
 				case 8:
 				case 16:
 
-					for (int y = 0; y < height; y++)
-					{
-						memcpy(image.scanLine(y), src, widthBytes);
-						src += bytesPerLine;
-					}
+					for (int y = 0; y < height; y++)
+					{
+						memcpy(image.scanLine(y), src, widthBytes);
+						src += bytesPerLine;
+					}
+
+					break;
+
+				case 32:
+				{
+					for (int y = 0; y < height; y++)
+					{
+						PixelConversion::argbToRgba(
+							src, image.scanLine(y), width, alpha);
+						src += bytesPerLine;
+					}
+
+					break;
+				}
+
+				default:
+					Q_UNREACHABLE();
+					break;
+			}
+
+			break;
+		}
+	}
+
+	decodeScope.finish();
+
+	Q_ASSERT(not image.isNull());
+	Q_ASSERT(not originalSize->isEmpty());
+	return Converter::OK;
+}
+
+int Image::decodeSource(
+	const ImageExportOptions &options, const Converter::Scales &scales)
+{
+	// Tag may be released after this, so cache keys are made here
+	if (nullptr != options.cache)
+	{
+		auto scaleOptions = options;
+
+		for (size_t i = 0; i < scales.size(); i++)
+		{
+			scaleOptions.scale = scales[i];
+			scaleOptions.scaleIndex = int(i);
+			sourceCacheKeys.push_back(cacheKey(scaleOptions));
+		}
+	}
+
+	// Scales are sorted, the largest one limits JPEG downscaling
+	int decodeResult =
+		decode(&source, &sourceSize, scales.front(), options.profiler);
+
+	if (decodeResult != Converter::OK)
+		return decodeResult;
+
+	if (nullptr != options.cache || nullptr != options.deduplicator ||
+		options.keepPixels)
+	{
+		Profiler::Scope hashScope(
+			options.profiler, "image.hash", profileSubject);
+		sourcePixelKeys = ImageDeduplicator::pixelKeys(source, scales);
+	}
 
-					break;
+	return Converter::OK;
+}
 
-				case 32:
-				{
-					int srcPadding = bytesPerLine - widthBytes;
+int Image::exportImage(const QString &prefix, const ImageExportOptions &options)
+{
+	Q_ASSERT(nullptr != options.encoder);
+	Q_ASSERT(nullptr != options.resampler);
 
-					for (int y = 0; y < height; y++)
-					{
-						auto destLine = image.scanLine(y);
+	auto imageFilePath =
+		filePathForPrefix(prefix, options.encoder->fileSuffix());
+	qreal scale = options.scale;
 
-						for (int x = 0; x < width; x++)
-						{
-							quint8 a = *src++;
-							quint8 r = *src++;
-							quint8 g = *src++;
-							quint8 b = *src++;
-							*destLine++ = r;
-							*destLine++ = g;
-							*destLine++ = b;
-							*destLine++ = alpha ? a : 255;
-						}
+	auto profiler = options.profiler;
 
-						src += srcPadding;
-					}
+	QByteArray key;
 
-					break;
-				}
+	if (nullptr != options.cache)
+	{
+		Profiler::Scope cacheScope(profiler, "image.cache", profileSubject);
 
-				default:
-					Q_UNREACHABLE();
-					break;
-			}
+		if (not QDir().mkpath(QFileInfo(prefix).path()))
+		{
+			return Converter::OUTPUT_DIR_ERROR;
+		}
 
-			break;
+		key = options.scaleIndex >= 0
+			? sourceCacheKeys.at(size_t(options.scaleIndex))
+			: cacheKey(options);
+
+		// Without a pixel key the image could not be deduplicated
+		if (options.cache->fetch(
+				key, imageFilePath, &width, &height, &pixelKey) &&
+			(nullptr == options.deduplicator || not pixelKey.isEmpty()))
+		{
+			fileWritten = true;
+			options.log->info(fileName);
+			return Converter::OK;
 		}
 	}
 
-	Q_ASSERT(not image.isNull());
+	QImage image;
+	int scaledWidth;
+	int scaledHeight;
 
-	int scaledWidth = qCeil(image.width() * scale);
-	int scaledHeight = qCeil(image.height() * scale);
+	if (options.scaleIndex >= 0)
+	{
+		// Decoded by decodeSource() for all scales
+		Q_ASSERT(not source.isNull());
+		scaledWidth = qCeil(sourceSize.width() * scale);
+		scaledHeight = qCeil(sourceSize.height() * scale);
+	} else
+	{
+		QSize originalSize;
+		int decodeResult = decode(&image, &originalSize, scale, profiler);
+
+		if (decodeResult != Converter::OK)
+			return decodeResult;
+
+		scaledWidth = qCeil(originalSize.width() * scale);
+		scaledHeight = qCeil(originalSize.height() * scale);
+	}
 
 	width = scaledWidth;
 	height = scaledHeight;
@@ -957,57 +2165,117 @@ int Image::exportImage(const QString &prefix, qreal scale)
 		return Converter::BAD_SCALE_VALUE;
 	}
 
-	if (scaledWidth != image.width() || scaledHeight != image.height())
+	if (options.scaleIndex >= 0)
+	{
+		if (not sourcePixelKeys.empty())
+			pixelKey = sourcePixelKeys.at(size_t(options.scaleIndex));
+	} else if (nullptr != options.cache || nullptr != options.deduplicator ||
+		options.keepPixels)
+	{
+		Profiler::Scope hashScope(profiler, "image.hash", profileSubject);
+		pixelKey = ImageDeduplicator::pixelKey(image, scale);
+	}
+
+	QByteArray sharedKey;
+
+	if (nullptr != options.deduplicator)
+	{
+		sharedKey = deduplicationKey(options);
+
+		switch (options.deduplicator->claim(sharedKey,
+			options.ownerId, index, imageFilePath, &sourceIndex))
+		{
+			case ImageDeduplicator::ALIAS:
+				return Converter::OK;
+
+			case ImageDeduplicator::LINKED:
+				fileWritten = true;
+				options.log->info(fileName);
+				return Converter::OK;
+
+			case ImageDeduplicator::ENCODE:
+				break;
+		}
+	}
+
+	if (options.scaleIndex >= 0)
 	{
-		image = image.scaled(scaledWidth, scaledHeight,
-			Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+		Profiler::Scope scaleScope(profiler, "image.scale", profileSubject);
+		scaleScope.setBytes(qint64(source.bytesPerLine()) * source.height());
+
+		image = mipScaled(
+			*options.resampler, &source, scaledWidth, scaledHeight);
+	} else if (scaledWidth != image.width() || scaledHeight != image.height())
+	{
+		Profiler::Scope scaleScope(profiler, "image.scale", profileSubject);
+		scaleScope.setBytes(qint64(image.bytesPerLine()) * image.height());
+
+		// Same size as mipScaled gives, shape bounds assume it
+		image = options.resampler->scaled(image, scaledWidth, scaledHeight);
 	}
 
-	if (not QDir().mkpath(QFileInfo(prefix).path()))
+	if (options.keepPixels)
 	{
-		return Converter::OUTPUT_DIR_ERROR;
+		// Texture atlas pages are encoded after all images are decoded
+		pixels = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+		return Converter::OK;
 	}
 
 	errorInfo = imageFilePath;
 
-	QSaveFile file(imageFilePath);
+	QByteArray encoded;
 
-	if (not file.open(QFile::WriteOnly | QFile::Truncate))
 	{
-		return Converter::OUTPUT_FILE_WRITE_ERROR;
+		Profiler::Scope encodeScope(profiler, "image.encode", profileSubject);
+
+		if (not options.encoder->encode(image, &encoded))
+		{
+			return Converter::OUTPUT_FILE_WRITE_ERROR;
+		}
+
+		encodeScope.setBytes(encoded.size());
 	}
 
-	if (not image.save(&file, "png") || not file.commit())
+	Profiler::Scope commitScope(profiler, "image.commit", profileSubject);
+	commitScope.setBytes(encoded.size());
+
+	int saveResult = saveImageFile(options.sink, imageFilePath, encoded);
+
+	if (saveResult != Converter::OK)
+		return saveResult;
+
+	commitScope.finish();
+	fileWritten = true;
+
+	if (nullptr != options.cache)
+		options.cache->store(key, imageFilePath, pixelKey);
+
+	if (nullptr != options.deduplicator)
 	{
-		return Converter::OUTPUT_FILE_WRITE_ERROR;
+		options.deduplicator->publish(
+			sharedKey, options.ownerId, index, imageFilePath);
 	}
 
-	qInfo().noquote() << fileName;
+	options.log->info(fileName);
 	return Converter::OK;
 }
 
 bool Converter::Process::handleShowFrame()
 {
-	if (currentFrame == nullptr)
+	if (not timeline.hasCurrentFrame())
 	{
 		errorInfo = QString("Show frame failed");
 		result = INPUT_FILE_BAD_DATA_ERROR;
 		return false;
 	}
 
-	currentFrame++;
-
-	if (currentFrame > &frames.back())
-	{
-		currentFrame = nullptr;
-	}
-
+	timeline.nextFrame();
 	return true;
 }
 
 bool Converter::Process::handleFrameLabel(TAG *tag)
 {
-	if (currentFrame == nullptr)
+	if (not timeline.hasCurrentFrame())
 	{
 		errorInfo = QString("Frame label failed");
 		result = INPUT_FILE_BAD_DATA_ERROR;
@@ -1020,23 +2288,17 @@ bool Converter::Process::handleFrameLabel(TAG *tag)
 
 	auto &renameMap = owner->mLabelRenameMap;
 	auto it = renameMap.find(labelName);
+	auto newLabelName = it != renameMap.end() ? it->second : labelName;
 
-	if (it != renameMap.end())
-	{
-		currentFrame->labelName = it->second;
-	} else
-	{
-		currentFrame->labelName = labelName;
-	}
-
-	renames[labelName] = currentFrame->labelName;
+	timeline.setLabelName(newLabelName);
+	renames[labelName] = newLabelName;
 
 	return true;
 }
 
 bool Converter::Process::handlePlaceObject(TAG *tag)
 {
-	if (currentFrame == nullptr)
+	if (not timeline.hasCurrentFrame())
 	{
 		errorInfo = QString("Place object failed");
 		result = INPUT_FILE_BAD_DATA_ERROR;
@@ -1067,7 +2329,7 @@ bool Converter::Process::handlePlaceObject(TAG *tag)
 
 	bool placeObject1 = (tag->id == ST_PLACEOBJECT);
 
-	Frame::ObjectMove move;
+	Timeline::ObjectMove move;
 	move.flags = 0;
 
 	bool shouldMove = (placeObject1 || 0 != (srcObj.flags & PF_MOVE));
@@ -1076,7 +2338,7 @@ bool Converter::Process::handlePlaceObject(TAG *tag)
 	{
 		if (shouldMove)
 		{
-			currentFrame->removes.push_back(depth);
+			timeline.addRemove(depth);
 			move.flags |= PF_CHAR;
 		}
 
@@ -1089,14 +2351,14 @@ bool Converter::Process::handlePlaceObject(TAG *tag)
 			return false;
 		}
 
-		Frame::ObjectAdd add;
+		Timeline::ObjectAdd add;
 		add.depth = depth;
 		add.shapeId = quint16(shapeRefIt->second);
 
 		if (depth < firstDepth)
 			firstDepth = depth;
 
-		currentFrame->adds.push_back(add);
+		timeline.addObject(add);
 	}
 
 	if (placeObject1 || 0 != (srcObj.flags & PF_CXFORM))
@@ -1145,7 +2407,7 @@ bool Converter::Process::handlePlaceObject(TAG *tag)
 		move.addColor.g = addColorToByte(srcObj.cxform.g1);
 		move.addColor.b = addColorToByte(srcObj.cxform.b1);
 
-		currentFrame->moves.push_back(move);
+		timeline.addMove(move);
 	}
 
 	return true;
@@ -1153,62 +2415,383 @@ bool Converter::Process::handlePlaceObject(TAG *tag)
 
 bool Converter::Process::handleRemoveObject(TAG *tag)
 {
-	if (currentFrame == nullptr)
+	if (not timeline.hasCurrentFrame())
 	{
 		errorInfo = QString("Remove object failed");
 		result = INPUT_FILE_BAD_DATA_ERROR;
 		return false;
 	}
 
-	currentFrame->removes.push_back(quint16(swf_GetDepth(tag)));
+	timeline.addRemove(quint16(swf_GetDepth(tag)));
 
 	return true;
 }
 
-bool Converter::Process::handleImage(TAG *tag)
+QString Converter::Process::prefixForScale(qreal scale) const
 {
-	auto prefix = this->prefix;
+	auto name = QFileInfo(owner->mInputFilePath).baseName();
+
+	if (multiScale)
+		name = nameForScale(name, scale);
+
+	// Sink receives names relative to the output
+	return owner->mSink ? name : owner->outputFilePath(name);
+}
 
+QString Converter::Process::imagePrefix() const
+{
 	switch (owner->mSamVersion)
 	{
 		case SAM_VERSION_1:
-			prefix += '_';
-			break;
+			return prefix + '_';
 
 		case SAM_VERSION_2:
-			prefix += '/';
-			break;
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
+			return prefix + '/';
+	}
 
-		default:
-			return false;
+	return QString();
+}
+
+ImageExportOptions Converter::Process::imageExportOptions() const
+{
+	ImageExportOptions options;
+	options.scale = currentScale;
+	options.encoder = &owner->mImageEncoder;
+	options.profiler = owner->mProfiler.get();
+	options.ownerId = ownerId;
+	options.sink = owner->mSink.get();
+	options.log = &log;
+	options.resampler = &owner->mImageResampler;
+	options.keepPixels = owner->mAtlas;
+
+	// Atlas pages are packed from pixels, not from image files
+	if (not owner->mAtlas && nullptr == options.sink)
+	{
+		options.cache = imageCache.get();
+		options.deduplicator = owner->mImageDeduplicator.get();
 	}
 
+	return options;
+}
+
+bool Converter::Process::handleImage(TAG *tag)
+{
+	auto prefix = imagePrefix();
+
+	if (prefix.isEmpty())
+		return false;
+
 	auto index = images.size();
 	images.push_back(Image(tag, jpegTables, index));
 	imageMap[GET16(tag->data)] = index;
 
+	auto &encoder = owner->mImageEncoder;
+
 	Image &image = images.back();
+	image.setFilePath(image.filePathForPrefix(prefix, encoder.fileSuffix()));
+
+	// Decoding, scaling and encoding do not depend on other tags,
+	// so let the tag walk continue while the image is exported.
+	// std::deque keeps the image address stable for the job.
+	// With multiple scales the image is only decoded here.
+	auto options = imageExportOptions();
+	const Scales *decodeScales = multiScale ? &scales : nullptr;
+
+	bool releaseTag = owner->mStreaming;
+	Image *imagePtr = &image;
+	image.exportJob = QtConcurrent::run(imageThreadPool(),
+		[imagePtr, prefix, options, decodeScales, releaseTag]() -> int {
+			int imageResult = nullptr != decodeScales
+				? imagePtr->decodeSource(options, *decodeScales)
+				: imagePtr->exportImage(prefix, options);
+
+			if (releaseTag)
+			{
+				StreamSWFReader::freeTag(imagePtr->tag);
+				imagePtr->tag = nullptr;
+			}
 
-	result = image.exportImage(prefix, owner->mScale);
+			return imageResult;
+		});
 
-	switch (result)
+	if (owner->mStreaming)
 	{
-		case OK:
-			break;
+		// Do not let the tag reader run too far ahead of image export,
+		// otherwise pending tags would occupy memory all at once
+		size_t maxPending = size_t(imageThreadPool()->maxThreadCount()) * 2;
 
-		case BAD_SCALE_VALUE:
-		case INPUT_FILE_BAD_DATA_ERROR:
-		case OUTPUT_DIR_ERROR:
-		case OUTPUT_FILE_WRITE_ERROR:
-			errorInfo = image.errorInfo;
-			return false;
+		while (images.size() - firstPendingImage > maxPending)
+		{
+			images.at(firstPendingImage++).exportJob.waitForFinished();
+		}
+	}
 
-		default:
-			Q_UNREACHABLE();
+	return true;
+}
+
+bool Converter::Process::waitForImages()
+{
+	// Do not override an error reported by the tag walk
+	bool ok = (result == OK);
+
+	for (Image &image : images)
+	{
+		int imageResult = image.exportJob.result();
+
+		if (not ok)
+			continue;
+
+		switch (imageResult)
+		{
+			case OK:
+				break;
+
+			case BAD_SCALE_VALUE:
+			case INPUT_FILE_BAD_DATA_ERROR:
+			case OUTPUT_DIR_ERROR:
+			case OUTPUT_FILE_WRITE_ERROR:
+				errorInfo = image.errorInfo;
+				result = imageResult;
+				ok = false;
+				break;
+
+			default:
+				Q_UNREACHABLE();
+				ok = false;
+				break;
+		}
+	}
+
+	return ok;
+}
+
+bool Converter::Process::exportScaledImages(size_t scaleIndex)
+{
+	// Shape image indices are replaced by deduplication
+	if (scaleIndex == 0)
+	{
+		for (const Shape &shape : shapes)
+		{
+			shapeImages.push_back(shape.imageIndex);
+		}
+	} else
+	{
+		for (size_t i = 0; i < shapes.size(); i++)
+		{
+			shapes[i].imageIndex = shapeImages.at(i);
+		}
+
+		// Each scale is deduplicated like a separate conversion
+		ownerId = ImageDeduplicator::newOwnerId();
+	}
+
+	auto options = imageExportOptions();
+	options.scaleIndex = int(scaleIndex);
+
+	auto prefix = imagePrefix();
+	auto suffix = owner->mImageEncoder.fileSuffix();
+
+	// Decoded pixels are not needed after the last scale
+	bool lastScale = scaleIndex + 1 == scales.size();
+
+	for (Image &image : images)
+	{
+		image.resetExport(image.filePathForPrefix(prefix, suffix));
+
+		Image *imagePtr = &image;
+		image.exportJob = QtConcurrent::run(imageThreadPool(),
+			[imagePtr, prefix, options, lastScale]() -> int {
+				int imageResult = imagePtr->exportImage(prefix, options);
+
+				if (lastScale)
+					imagePtr->source = QImage();
+
+				return imageResult;
+			});
+	}
+
+	return waitForImages();
+}
+
+void Converter::Process::deduplicateImages()
+{
+	if (not owner->mImageDeduplicator)
+		return;
+
+	// Image jobs finish in any order, so the final choice is made here:
+	// the first image with the same pixels is referenced by all others
+	std::map<QByteArray, size_t> firstImages;
+
+	for (Image &image : images)
+	{
+		if (image.pixelKey.isEmpty())
+			continue;
+
+		auto it = firstImages.find(image.pixelKey);
+
+		if (it == firstImages.end())
+		{
+			image.sourceIndex = image.index;
+			firstImages[image.pixelKey] = image.index;
+			continue;
+		}
+
+		image.sourceIndex = it->second;
+		image.fileName = images.at(image.sourceIndex).fileName;
+
+		if (image.fileWritten)
+		{
+			QFile::remove(image.filePathForPrefix(
+				imagePrefix(), owner->mImageEncoder.fileSuffix()));
+			image.fileWritten = false;
+		}
+	}
+
+	for (Shape &shape : shapes)
+	{
+		if (shape.imageIndex >= 0)
+		{
+			shape.imageIndex = int(images.at(shape.imageIndex).sourceIndex);
+		}
+	}
+}
+
+bool Converter::Process::packAtlas()
+{
+	// Images with equal pixels share the same place in the atlas
+	std::map<QByteArray, size_t> slotMap;
+	std::vector<size_t> imageSlots(images.size());
+	std::vector<const Image *> slotImages;
+	TextureAtlas::Sizes sizes;
+
+	for (const Image &image : images)
+	{
+		auto it = slotMap.find(image.pixelKey);
+
+		if (it != slotMap.end())
+		{
+			imageSlots[image.index] = it->second;
+			continue;
+		}
+
+		size_t slot = sizes.size();
+		slotMap[image.pixelKey] = slot;
+		imageSlots[image.index] = slot;
+		slotImages.push_back(&image);
+		sizes.push_back(image.pixels.size());
+	}
+
+	auto profiler = owner->mProfiler.get();
+
+	TextureAtlas atlas(
+		owner->mAtlasPageSize, owner->mAtlasPadding, owner->mAtlasExtrude);
+
+	// Pages are never made larger than the page size option
+	for (size_t slot = 0; slot < slotImages.size(); slot++)
+	{
+		if (not atlas.fits(sizes.at(slot)))
+		{
+			errorInfo = slotImages.at(slot)->fileName;
+			result = ATLAS_IMAGE_TOO_LARGE;
 			return false;
+		}
 	}
 
-	return true;
+	TextureAtlas::Placements placements;
+
+	{
+		Profiler::Scope packScope(
+			profiler, "atlas.pack", QFileInfo(prefix).fileName());
+		placements = atlas.pack(sizes);
+	}
+
+	std::vector<QImage> pages;
+
+	for (auto &size : atlas.pageSizes())
+	{
+		pages.emplace_back(size, QImage::Format_RGBA8888_Premultiplied);
+		pages.back().fill(Qt::transparent);
+	}
+
+	for (size_t slot = 0; slot < slotImages.size(); slot++)
+	{
+		auto &placement = placements.at(slot);
+		atlas.draw(pages.at(size_t(placement.page)),
+			slotImages.at(slot)->pixels, placement.rect);
+	}
+
+	for (Image &image : images)
+	{
+		auto &placement = placements.at(imageSlots.at(image.index));
+		image.atlasPage = placement.page;
+		image.atlasRect = placement.rect;
+		image.pixels = QImage();
+	}
+
+	auto &encoder = owner->mImageEncoder;
+	auto pagePrefix = imagePrefix();
+	std::vector<QFuture<int>> jobs;
+	QStringList pageFilePaths;
+
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		auto filePath = imageFilePath(pagePrefix, i, encoder.fileSuffix());
+		auto page = pages.at(i);
+		pageFilePaths.append(filePath);
+
+		auto sink = owner->mSink.get();
+		auto pageLog = &log;
+
+		jobs.push_back(QtConcurrent::run(imageThreadPool(),
+			[&encoder, profiler, sink, pageLog, filePath, page]() -> int {
+				auto fileName = QFileInfo(filePath).fileName();
+				QByteArray encoded;
+
+				{
+					Profiler::Scope encodeScope(
+						profiler, "atlas.encode", fileName);
+
+					if (not encoder.encode(page, &encoded))
+						return OUTPUT_FILE_WRITE_ERROR;
+
+					encodeScope.setBytes(encoded.size());
+				}
+
+				Profiler::Scope commitScope(
+					profiler, "atlas.commit", fileName);
+				commitScope.setBytes(encoded.size());
+
+				int saveResult = saveImageFile(sink, filePath, encoded);
+
+				if (saveResult == OK)
+					pageLog->info(fileName);
+
+				return saveResult;
+			}));
+	}
+
+	pages.clear();
+
+	bool ok = true;
+
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		int pageResult = jobs.at(i).result();
+
+		if (ok && pageResult != OK)
+		{
+			errorInfo = pageFilePaths.at(int(i));
+			result = pageResult;
+			ok = false;
+		}
+	}
+
+	if (ok)
+		outputs.append(pageFilePaths);
+
+	return ok;
 }
 
 bool Converter::Process::handleShape(TAG *tag)
@@ -1266,7 +2849,7 @@ bool Converter::Process::handleShape(TAG *tag)
 
 				fillStyleMap[i + 1] = shapes.size();
 
-				shapes.emplace_back();
+				shapes.emplace_back(arenaLease.arena());
 				Shape &shape = shapes.back();
 
 				auto it = imageMap.find(imageId);
@@ -1294,7 +2877,7 @@ bool Converter::Process::handleShape(TAG *tag)
 				{
 					fillStyleMap[i + 1] = shapes.size();
 
-					shapes.emplace_back();
+					shapes.emplace_back(arenaLease.arena());
 					Shape &shape = shapes.back();
 
 					shape.color = fillStyle.color;
@@ -1363,16 +2946,16 @@ bool Converter::Process::handleShape(TAG *tag)
 		{
 			auto &poly = shapes.at(it->second).vertices;
 
-			if (poly.isEmpty() && line->type == lineTo)
+			if (poly.empty() && line->type == lineTo)
 			{
-				poly.append(QPoint());
+				poly.push_back(QPoint());
 			}
 
 			switch (line->type)
 			{
 				case moveTo:
 				{
-					if (not poly.isEmpty())
+					if (not poly.empty())
 					{
 						if (not owner->mSkipUnsupported)
 						{
@@ -1387,7 +2970,7 @@ bool Converter::Process::handleShape(TAG *tag)
 
 				case lineTo:
 				{
-					poly.append(QPoint(line->x, line->y));
+					poly.push_back(QPoint(line->x, line->y));
 					break;
 				}
 
@@ -1436,28 +3019,96 @@ bool Converter::Process::handleShape(TAG *tag)
 		return false;
 	}
 
-	if (shapeCount > depthMultiplier)
-		depthMultiplier = quint8(shapeCount);
+	if (shapeCount > depthMultiplier)
+		depthMultiplier = quint8(shapeCount);
+
+	return ok;
+}
+
+QIODevice *Converter::Process::openInput(QFile &file, QBuffer &buffer)
+{
+	QIODevice *device;
+
+	if (nullptr != owner->mInputDevice)
+	{
+		device = owner->mInputDevice;
+	} else if (not owner->mInputData.isEmpty())
+	{
+		buffer.setData(owner->mInputData);
+		device = &buffer;
+	} else
+	{
+		file.setFileName(owner->mInputFilePath);
+		device = &file;
+	}
+
+	inputOpened = false;
+
+	if (not device->isOpen())
+	{
+		if (not device->open(QIODevice::ReadOnly))
+		{
+			result = INPUT_FILE_OPEN_ERROR;
+			return nullptr;
+		}
+
+		inputOpened = true;
+	}
+
+	return device;
+}
 
-	return ok;
+void Converter::Process::closeInput(QIODevice *device)
+{
+	// Only a device opened by openInput is closed, so a device
+	// passed by the caller open stays usable
+	if (inputOpened)
+		device->close();
+
+	inputOpened = false;
 }
 
 bool Converter::Process::readSWF()
 {
-	QFile inputFile(owner->mInputFilePath);
+	std::unique_ptr<MappedSWFReader> mapped(new MappedSWFReader);
+
+	bool mappedOk = false;
 
-	if (not inputFile.open(QFile::ReadOnly))
+	if (nullptr == owner->mInputDevice)
 	{
-		result = INPUT_FILE_OPEN_ERROR;
-		return false;
+		mappedOk = owner->mInputData.isEmpty()
+			? mapped->open(owner->mInputFilePath)
+			: mapped->open(owner->mInputData);
+	}
+
+	if (mappedOk)
+	{
+		if (not mapped->read(&swf))
+		{
+			result = INPUT_FILE_FORMAT_ERROR;
+			return false;
+		}
+
+		mappedReader = std::move(mapped);
+		return true;
 	}
 
+	mapped.reset();
+
+	QFile inputFile;
+	QBuffer inputBuffer;
+	auto input = openInput(inputFile, inputBuffer);
+
+	if (nullptr == input)
+		return false;
+
 	reader_t reader;
-	QIODeviceSWFReader::init(&reader, &inputFile);
+	QIODeviceSWFReader::init(&reader, input);
 
 	bool ok = swf_ReadSWF2(&reader, &swf) >= 0;
 
 	reader.dealloc(&reader);
+	closeInput(input);
 
 	if (not ok)
 	{
@@ -1469,73 +3120,143 @@ bool Converter::Process::readSWF()
 
 bool Converter::Process::parseSWF()
 {
-	frames.resize(swf.frameCount);
-
-	currentFrame = &frames.front();
+	prepareFrames();
 
 	auto tag = swf.firstTag;
 	bool ok = true;
 
 	while (tag && ok)
 	{
-		switch (tag->id)
-		{
-			case ST_FILEATTRIBUTES:
-			case ST_SETBACKGROUNDCOLOR:
-			case ST_SCENEDESCRIPTION:
-			case ST_METADATA:
-			case ST_DOABC:
-			case ST_SYMBOLCLASS:
-			case ST_END:
-				// ignore
-				break;
+		ok = handleTag(tag);
+		tag = swf_NextTag(tag);
+	}
 
-			case ST_SHOWFRAME:
-				ok = handleShowFrame();
-				break;
+	return ok;
+}
 
-			case ST_FRAMELABEL:
-				ok = handleFrameLabel(tag);
-				break;
+bool Converter::Process::streamSWF()
+{
+	QFile inputFile;
+	QBuffer inputBuffer;
+	auto input = openInput(inputFile, inputBuffer);
 
-			case ST_PLACEOBJECT:
-			case ST_PLACEOBJECT2:
-			case ST_PLACEOBJECT3:
-				ok = handlePlaceObject(tag);
-				break;
+	if (nullptr == input)
+		return false;
 
-			case ST_REMOVEOBJECT:
-			case ST_REMOVEOBJECT2:
-				ok = handleRemoveObject(tag);
-				break;
+	StreamSWFReader reader;
 
-			case ST_JPEGTABLES:
-				jpegTables = tag;
-				break;
+	if (not reader.open(input, &swf))
+	{
+		reader.close();
+		closeInput(input);
+		result = INPUT_FILE_FORMAT_ERROR;
+		return false;
+	}
 
-			case ST_DEFINEBITSLOSSLESS:
-			case ST_DEFINEBITSLOSSLESS2:
-			case ST_DEFINEBITSJPEG:
-			case ST_DEFINEBITSJPEG2:
-			case ST_DEFINEBITSJPEG3:
-				ok = handleImage(tag);
-				break;
+	prepareFrames();
 
-			case ST_DEFINESHAPE:
-			case ST_DEFINESHAPE2:
-			case ST_DEFINESHAPE3:
-			case ST_DEFINESHAPE4:
-				ok = handleShape(tag);
-				break;
+	bool ok = true;
 
-			default:
+	while (ok)
+	{
+		auto tag = reader.readTag();
+
+		if (nullptr == tag)
+		{
+			if (reader.hasError())
+			{
+				result = INPUT_FILE_FORMAT_ERROR;
 				ok = false;
-				errorInfo = tag->id;
-				result = UNSUPPORTED_TAG;
-				break;
+			}
+
+			break;
 		}
 
-		tag = swf_NextTag(tag);
+		size_t imageCount = images.size();
+
+		ok = handleTag(tag);
+
+		if (tag == jpegTables)
+		{
+			// Any later JPEG image can reference the tables
+			retainedTags.push_back(tag);
+		} else if (images.size() == imageCount)
+		{
+			StreamSWFReader::freeTag(tag);
+		}
+		// otherwise the image export job releases the tag
+	}
+
+	reader.close();
+	closeInput(input);
+
+	return ok;
+}
+
+void Converter::Process::prepareFrames()
+{
+	timeline.reset(swf.frameCount);
+}
+
+bool Converter::Process::handleTag(TAG *tag)
+{
+	bool ok = true;
+
+	switch (tag->id)
+	{
+		case ST_FILEATTRIBUTES:
+		case ST_SETBACKGROUNDCOLOR:
+		case ST_SCENEDESCRIPTION:
+		case ST_METADATA:
+		case ST_DOABC:
+		case ST_SYMBOLCLASS:
+		case ST_END:
+			// ignore
+			break;
+
+		case ST_SHOWFRAME:
+			ok = handleShowFrame();
+			break;
+
+		case ST_FRAMELABEL:
+			ok = handleFrameLabel(tag);
+			break;
+
+		case ST_PLACEOBJECT:
+		case ST_PLACEOBJECT2:
+		case ST_PLACEOBJECT3:
+			ok = handlePlaceObject(tag);
+			break;
+
+		case ST_REMOVEOBJECT:
+		case ST_REMOVEOBJECT2:
+			ok = handleRemoveObject(tag);
+			break;
+
+		case ST_JPEGTABLES:
+			jpegTables = tag;
+			break;
+
+		case ST_DEFINEBITSLOSSLESS:
+		case ST_DEFINEBITSLOSSLESS2:
+		case ST_DEFINEBITSJPEG:
+		case ST_DEFINEBITSJPEG2:
+		case ST_DEFINEBITSJPEG3:
+			ok = handleImage(tag);
+			break;
+
+		case ST_DEFINESHAPE:
+		case ST_DEFINESHAPE2:
+		case ST_DEFINESHAPE3:
+		case ST_DEFINESHAPE4:
+			ok = handleShape(tag);
+			break;
+
+		default:
+			ok = false;
+			errorInfo = tag->id;
+			result = UNSUPPORTED_TAG;
+			break;
 	}
 
 	return ok;
@@ -1543,9 +3264,35 @@ bool Converter::Process::parseSWF()
 
 bool Converter::Process::exportSAM()
 {
-	QFileInfo fileInfo(prefix + ".sam");
+	auto filePath = prefix + ".sam";
+
+	errorInfo = filePath;
 
-	errorInfo = fileInfo.filePath();
+	bool ok = owner->mSink ? writeSAMToSink(filePath) : writeSAMFile(filePath);
+
+	if (not ok)
+		return false;
+
+	log.info(QFileInfo(filePath).fileName());
+	log.info(QString("Labels:"));
+
+	for (auto &it : renames)
+	{
+		if (it.first != it.second)
+		{
+			log.info(QString("%1 -> %2").arg(it.first, it.second));
+		} else
+		{
+			log.info(it.first);
+		}
+	}
+
+	return true;
+}
+
+bool Converter::Process::writeSAMFile(const QString &filePath)
+{
+	QFileInfo fileInfo(filePath);
 
 	if (not QDir().mkpath(fileInfo.path()))
 	{
@@ -1561,33 +3308,99 @@ bool Converter::Process::exportSAM()
 		return false;
 	}
 
+	auto profiler = owner->mProfiler.get();
+
+	if (owner->mSamCompressor.isEnabled())
+	{
+		// Compressed envelope needs whole SAM data in memory
+		QByteArray data;
+
+		if (not writeSAMData(fileInfo.fileName(), &data))
+			return false;
+
+		if (samFile.write(data) != data.size())
+		{
+			result = OUTPUT_FILE_WRITE_ERROR;
+			return false;
+		}
+	} else
 	{
+		Profiler::Scope writeScope(profiler, "sam.write", fileInfo.fileName());
 		SAMWriter writer(*this, &samFile);
 
 		if (not writer.exec())
 			return false;
+
+		writeScope.setBytes(samFile.pos());
 	} // close writer
 
+	Profiler::Scope commitScope(profiler, "sam.commit", fileInfo.fileName());
+
 	if (not samFile.commit())
 	{
 		result = OUTPUT_FILE_WRITE_ERROR;
 		return false;
 	}
 
-	qInfo().noquote() << fileInfo.fileName();
-	qInfo().noquote() << QString("Labels:");
+	return true;
+}
 
-	for (auto &it : renames)
+bool Converter::Process::writeSAMToSink(const QString &name)
+{
+	auto profiler = owner->mProfiler.get();
+	auto fileName = QFileInfo(name).fileName();
+
+	QByteArray data;
+
+	if (not writeSAMData(fileName, &data))
+		return false;
+
+	Profiler::Scope commitScope(profiler, "sam.commit", fileName);
+
+	int sinkResult = owner->mSink->writeSAM(name, data);
+
+	if (sinkResult != OK)
 	{
-		if (it.first != it.second)
-		{
-			qInfo().noquote() << QString("%1 -> %2").arg(it.first, it.second);
-		} else
-		{
-			qInfo().noquote() << it.first;
-		}
+		result = sinkResult;
+		return false;
+	}
+
+	return true;
+}
+
+bool Converter::Process::writeSAMData(const QString &fileName, QByteArray *data)
+{
+	Q_ASSERT(nullptr != data);
+
+	auto profiler = owner->mProfiler.get();
+
+	{
+		Profiler::Scope writeScope(profiler, "sam.write", fileName);
+		SAMWriter writer(*this, nullptr);
+
+		if (not writer.exec())
+			return false;
+
+		*data = writer.takeData();
+		writeScope.setBytes(data->size());
+	}
+
+	auto &compressor = owner->mSamCompressor;
+
+	if (not compressor.isEnabled())
+		return true;
+
+	Profiler::Scope compressScope(profiler, "sam.compress", fileName);
+	QByteArray compressed;
+
+	if (not compressor.compress(*data, &compressed))
+	{
+		result = BAD_SAM_COMPRESSION;
+		return false;
 	}
 
+	data->swap(compressed);
+	compressScope.setBytes(data->size());
 	return true;
 }
 
@@ -1595,12 +3408,51 @@ Converter::Process::SAMWriter::SAMWriter(Process &owner, QIODevice *device)
 	: owner(owner)
 	, stream(device)
 {
-	stream.setByteOrder(QDataStream::LittleEndian);
+
+	// Output depths and added input depth offsets never exceed max depth
+	size_t depthCount = owner.maxDepth() + 1;
+	removeMarks.reset(depthCount);
+	charMoveMarks.reset(depthCount);
+	moveMap.reset(depthCount);
+	depthMap.reset(depthCount);
+	displayList.reset(depthCount);
 }
 
 bool Converter::Process::SAMWriter::exec()
 {
-	return writeHeader() && writeShapes() && writeFrames();
+	stream.reserve(estimatedSize());
+
+	return writeHeader() && writeShapes() && writeFrames() &&
+		writeSeekIndex() && stream.flush() && outputStreamOk();
+}
+
+QByteArray Converter::Process::SAMWriter::takeData()
+{
+	return stream.takeData();
+}
+
+int Converter::Process::SAMWriter::estimatedSize() const
+{
+	enum
+	{
+		HEADER_SIZE = 64,
+		SHAPE_SIZE = 40,
+		FRAME_SIZE = 8,
+		ADD_SIZE = 4,
+		REMOVE_SIZE = 2,
+		MOVE_SIZE = 16
+	};
+
+	qint64 size = HEADER_SIZE + qint64(owner.shapes.size()) * SHAPE_SIZE;
+
+	auto &timeline = owner.timeline;
+	size += qint64(timeline.frameCount()) * FRAME_SIZE +
+		qint64(timeline.labelBytes()) +
+		qint64(timeline.addCount()) * ADD_SIZE +
+		qint64(timeline.removeCount()) * REMOVE_SIZE +
+		qint64(timeline.moveCount()) * MOVE_SIZE;
+
+	return int(qMin(size, qint64(INT_MAX / 2)));
 }
 
 bool Converter::Process::SAMWriter::writeHeader()
@@ -1632,7 +3484,15 @@ bool Converter::Process::SAMWriter::writeHeader()
 			return true;
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
 			return writeString(QFileInfo(owner.prefix).fileName());
+
+		case SAM_VERSION_4:
+			if (not writeString(QFileInfo(owner.prefix).fileName()))
+				return false;
+
+			stream << quint8(owner.owner->mMatrixPrecision);
+			return outputStreamOk();
 	}
 
 	return false;
@@ -1663,6 +3523,8 @@ bool Converter::Process::SAMWriter::writeShapes()
 			return writeShapesV1();
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			return writeShapesV2();
 	}
 
@@ -1725,8 +3587,8 @@ bool Converter::Process::SAMWriter::writeShapesV2()
 			scaledHeight = image.height;
 		} else
 		{
-			auto bb = shape.vertices.boundingRect();
-			qreal scale = owner.owner->mScale;
+			auto bb = shape.boundingRect();
+			qreal scale = owner.currentScale;
 
 			scaledWidth = qCeil((bb.width() / TWIPS_PER_PIXELF) * scale);
 			scaledHeight = qCeil((bb.height() / TWIPS_PER_PIXELF) * scale);
@@ -1756,9 +3618,29 @@ bool Converter::Process::SAMWriter::writeShapesV2()
 			flags |= SYMBOLFLAGS_MATRIX;
 		}
 
-		stream << flags;
+		const Image *image = nullptr;
 
 		if (flags & SYMBOLFLAGS_BITMAP)
+		{
+			image = &owner.images.at(shape.imageIndex);
+
+			if (image->atlasPage >= 0)
+				flags |= SYMBOLFLAGS_ATLAS;
+		}
+
+		stream << flags;
+
+		if (flags & SYMBOLFLAGS_ATLAS)
+		{
+			// Atlas page image has the same file name as the image
+			// with the page index, followed by the image rect in the page
+			auto &rect = image->atlasRect;
+			stream << quint16(image->atlasPage);
+			stream << quint16(rect.x());
+			stream << quint16(rect.y());
+			stream << quint16(rect.width());
+			stream << quint16(rect.height());
+		} else if (flags & SYMBOLFLAGS_BITMAP)
 		{
 			stream << quint16(shape.imageIndex);
 		}
@@ -1789,65 +3671,224 @@ bool Converter::Process::SAMWriter::writeShapesV2()
 			stream << qint32(scaledY);
 		}
 
-		if (not outputStreamOk())
+		if (not outputStreamOk())
+			return false;
+	}
+
+	return true;
+}
+
+bool Converter::Process::SAMWriter::prepareObjectRemoves(
+	const Timeline::Frame &frame)
+{
+	removes.clear();
+	removeMarks.clear();
+
+	auto &timeline = owner.timeline;
+
+	for (size_t i = frame.removeBegin; i < frame.removeEnd; i++)
+	{
+		quint16 removeDepth = timeline.removeDepth(i);
+		auto depthRef = findDepthRef(removeDepth);
+
+		if (nullptr == depthRef)
+		{
+			continue;
+		}
+
+		for (size_t depth = depthRef->startDepth; depth <= depthRef->endDepth;
+			 depth++)
+		{
+			if (depth > owner.maxDepth())
+			{
+				owner.errorInfo = quint32(depth);
+				owner.result = UNSUPPORTED_OBJECT_DEPTH;
+				return false;
+			}
+
+			bool &marked = removeMarks.insert(depth);
+
+			if (not marked)
+			{
+				marked = true;
+				removes.push_back(quint16(depth));
+			}
+		}
+	}
+
+	std::sort(removes.begin(), removes.end());
+
+	return true;
+}
+
+DepthRef *Converter::Process::SAMWriter::findDepthRef(quint16 depth)
+{
+	if (depth < owner.firstDepth)
+		return nullptr;
+
+	return depthMap.find(size_t(depth - owner.firstDepth));
+}
+
+bool Converter::Process::SAMWriter::writeFrames()
+{
+	depthMap.clear();
+	moveMap.clear();
+	displayList.clear();
+	frameOffsets.clear();
+
+	if (not writeFrameCount())
+		return false;
+
+	auto &timeline = owner.timeline;
+	bool seekable = isSeekable();
+
+	for (size_t i = 0; i < timeline.frameCount(); i++)
+	{
+		auto frame = timeline.frame(i);
+
+		if (not prepareObjectRemoves(frame) || not prepareObjectAdds(frame) ||
+			not prepareObjectMoves(frame))
+		{
+			return false;
+		}
+
+		if (seekable)
+		{
+			if (stream.pos() > qint64(UINT_MAX))
+			{
+				owner.result = OUTPUT_FILE_WRITE_ERROR;
+				return false;
+			}
+
+			frameOffsets.push_back(quint32(stream.pos()));
+
+			if (isKeyframe(i))
+			{
+				if (not writeKeyframe(frame))
+					return false;
+
+				continue;
+			}
+
+			updateDisplayList();
+		}
+
+		if (not writeFrameFlags(frame, false) || not writeObjectRemoves() ||
+			not writeObjectAdds() || not writeObjectMoves() ||
+			not writeFrameLabel(frame))
+		{
 			return false;
+		}
 	}
 
 	return true;
 }
 
-bool Converter::Process::SAMWriter::prepareObjectRemoves(const Frame &frame)
+bool Converter::Process::SAMWriter::writeKeyframe(const Timeline::Frame &frame)
 {
+	applyObjectMoves();
+	updateDisplayList();
+
+	// Frame changes are replaced by the resulting display list
 	removes.clear();
+	adds.clear();
+	moves.clear();
 
-	for (quint16 removeDepth : frame.removes)
+	for (size_t depth = 0; depth < displayList.size(); depth++)
 	{
-		auto it = depthMap.find(removeDepth);
+		auto shapeId = displayList.find(depth);
 
-		if (it == depthMap.end())
+		if (nullptr == shapeId)
 		{
+			// Player forgets states of empty depths on keyframe
+			moveMap.erase(depth);
 			continue;
 		}
 
-		auto &depthRef = it->second;
+		Timeline::ObjectAdd add;
+		add.depth = quint16(depth);
+		add.shapeId = *shapeId;
+		adds.push_back(add);
 
-		for (size_t depth = depthRef.startDepth; depth <= depthRef.endDepth;
-			 depth++)
-		{
-			if (depth > owner.maxDepth())
-			{
-				owner.errorInfo = quint32(depth);
-				owner.result = UNSUPPORTED_OBJECT_DEPTH;
-				return false;
-			}
+		auto state = moveMap.find(depth);
 
-			removes.insert(quint16(depth));
+		if (nullptr != state)
+		{
+			moves.push_back(*state);
+			moves.back().flags = PF_CHAR | PF_MATRIX | PF_CXFORM;
 		}
 	}
 
-	return true;
+	return writeFrameFlags(frame, true) && writeObjectAdds() &&
+		writeObjectMoves() && writeFrameLabel(frame);
 }
 
-bool Converter::Process::SAMWriter::writeFrames()
+bool Converter::Process::SAMWriter::writeSeekIndex()
 {
-	depthMap.clear();
-	moveMap.clear();
+	if (not isSeekable())
+		return true;
 
-	if (not writeFrameCount())
+	qint64 indexOffset = stream.pos();
+
+	if (indexOffset > qint64(UINT_MAX))
+	{
+		owner.result = OUTPUT_FILE_WRITE_ERROR;
 		return false;
+	}
+
+	auto &timeline = owner.timeline;
+	Q_ASSERT(frameOffsets.size() == timeline.frameCount());
 
-	for (const auto &frame : owner.frames)
+	stream << quint32(frameOffsets.size());
+	stream << quint16(owner.owner->mKeyframeInterval);
+
+	for (quint32 offset : frameOffsets)
 	{
-		if (not prepareObjectRemoves(frame) || not prepareObjectAdds(frame) ||
-			not prepareObjectMoves(frame) || not writeFrameFlags(frame) ||
-			not writeObjectRemoves() || not writeObjectAdds() ||
-			not writeObjectMoves() || not writeFrameLabel(frame))
-		{
+		stream << offset;
+	}
+
+	quint32 labelCount = 0;
+
+	for (size_t i = 0; i < timeline.frameCount(); i++)
+	{
+		if (not timeline.frame(i).labelName.isEmpty())
+			labelCount++;
+	}
+
+	stream << labelCount;
+
+	for (size_t i = 0; i < timeline.frameCount(); i++)
+	{
+		auto labelName = timeline.frame(i).labelName;
+
+		if (labelName.isEmpty())
+			continue;
+
+		if (not writeString(labelName))
 			return false;
-		}
+
+		stream << quint32(i);
 	}
 
-	return true;
+	stream << quint32(indexOffset);
+	stream.writeRawData(SAM_IndexSignature, SAM_INDEX_SIGN_SIZE);
+
+	return outputStreamOk();
+}
+
+bool Converter::Process::SAMWriter::isSeekable() const
+{
+	return owner.owner->mSamVersion >= SAM_VERSION_3;
+}
+
+bool Converter::Process::SAMWriter::isKeyframe(size_t frameIndex) const
+{
+	auto interval = size_t(owner.owner->mKeyframeInterval);
+
+	if (interval == 0)
+		return frameIndex == 0;
+
+	return frameIndex % interval == 0;
 }
 
 bool Converter::Process::SAMWriter::writeString(const QString &str)
@@ -1885,6 +3926,8 @@ bool Converter::Process::SAMWriter::writeDisplayCount(size_t len)
 			break;
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			Q_ASSERT(len <= 65535);
 			stream << quint16(len);
 			break;
@@ -1912,17 +3955,22 @@ bool Converter::Process::SAMWriter::writeObjectRemoves()
 	return outputStreamOk();
 }
 
-bool Converter::Process::SAMWriter::prepareObjectAdds(const Frame &frame)
+bool Converter::Process::SAMWriter::prepareObjectAdds(
+	const Timeline::Frame &frame)
 {
 	adds.clear();
 
-	for (auto &add : frame.adds)
+	auto &timeline = owner.timeline;
+
+	for (size_t i = frame.addBegin; i < frame.addEnd; i++)
 	{
+		auto add = timeline.object(i);
 		const auto &shapeRef = owner.shapeRefs.at(add.shapeId);
 
-		auto &depthRef = depthMap[add.depth];
-		size_t depth =
-			size_t(add.depth - owner.firstDepth) * owner.depthMultiplier;
+		auto depthIndex = size_t(add.depth - owner.firstDepth);
+		size_t depth = depthIndex * owner.depthMultiplier;
+
+		DepthRef depthRef;
 		depthRef.startDepth = depth;
 		depthRef.endDepth = depth - 1;
 
@@ -1942,6 +3990,10 @@ bool Converter::Process::SAMWriter::prepareObjectAdds(const Frame &frame)
 			newAdd.shapeId = quint16(shapeIndex);
 			depthRef.endDepth++;
 		}
+
+		// Out of table only without shapes, nothing to move or remove then
+		if (depthIndex < depthMap.size())
+			depthMap.insert(depthIndex) = depthRef;
 	}
 
 	return true;
@@ -1955,7 +4007,7 @@ bool Converter::Process::SAMWriter::writeObjectAdds()
 	if (not writeDisplayCount(adds.size()))
 		return false;
 
-	for (const Frame::ObjectAdd &add : adds)
+	for (const Timeline::ObjectAdd &add : adds)
 	{
 		stream << quint16(add.depth);
 
@@ -1967,6 +4019,8 @@ bool Converter::Process::SAMWriter::writeObjectAdds()
 				break;
 
 			case SAM_VERSION_2:
+			case SAM_VERSION_3:
+			case SAM_VERSION_4:
 				Q_ASSERT(add.shapeId <= 65535);
 				stream << quint16(add.shapeId);
 				break;
@@ -1979,22 +4033,24 @@ bool Converter::Process::SAMWriter::writeObjectAdds()
 	return outputStreamOk();
 }
 
-bool Converter::Process::SAMWriter::prepareObjectMoves(const Frame &frame)
+bool Converter::Process::SAMWriter::prepareObjectMoves(
+	const Timeline::Frame &frame)
 {
 	moves.clear();
 
-	for (auto &move : frame.moves)
+	auto &timeline = owner.timeline;
+
+	for (size_t i = frame.moveBegin; i < frame.moveEnd; i++)
 	{
-		auto it = depthMap.find(move.depth);
+		auto move = timeline.move(i);
+		auto depthRef = findDepthRef(move.depth);
 
-		if (it == depthMap.end())
+		if (nullptr == depthRef)
 		{
 			continue;
 		}
 
-		auto &depthRef = it->second;
-
-		for (size_t depth = depthRef.startDepth; depth <= depthRef.endDepth;
+		for (size_t depth = depthRef->startDepth; depth <= depthRef->endDepth;
 			 depth++)
 		{
 			if (depth > owner.maxDepth())
@@ -2010,19 +4066,19 @@ bool Converter::Process::SAMWriter::prepareObjectMoves(const Frame &frame)
 		}
 	}
 
-	auto tempRemoves = removes;
+	// Removed depths forget previous state unless replaced in this frame
+	charMoveMarks.clear();
+
 	for (auto &move : moves)
 	{
-		auto it = tempRemoves.find(move.depth);
-		if (it != tempRemoves.end() && 0 != (move.flags & PF_CHAR))
-		{
-			tempRemoves.erase(it);
-		}
+		if (0 != (move.flags & PF_CHAR))
+			charMoveMarks.insert(move.depth) = true;
 	}
 
-	for (quint16 removeDepth : tempRemoves)
+	for (quint16 removeDepth : removes)
 	{
-		moveMap.erase(removeDepth);
+		if (nullptr == charMoveMarks.find(removeDepth))
+			moveMap.erase(removeDepth);
 	}
 
 	return true;
@@ -2036,14 +4092,14 @@ bool Converter::Process::SAMWriter::writeObjectMoves()
 	if (not writeDisplayCount(moves.size()))
 		return false;
 
-	for (Frame::ObjectMove &move : moves)
+	for (Timeline::ObjectMove &move : moves)
 	{
-		Frame::ObjectMove prev;
+		Timeline::ObjectMove prev;
 
-		auto it = moveMap.find(move.depth);
+		auto prevMove = moveMap.find(move.depth);
 
-		if (it != moveMap.end())
-			prev = it->second;
+		if (nullptr != prevMove)
+			prev = *prevMove;
 
 		switch (owner.owner->mSamVersion)
 		{
@@ -2055,28 +4111,63 @@ bool Converter::Process::SAMWriter::writeObjectMoves()
 				break;
 
 			case SAM_VERSION_2:
+			case SAM_VERSION_3:
 
 				if (not writeObjectMoveV2(move, prev))
 					return false;
 
 				break;
 
+			case SAM_VERSION_4:
+
+				if (not writeObjectMoveV4(move, prev))
+					return false;
+
+				break;
+
 			default:
 				return false;
 		}
 
-		moveMap[move.depth] = move;
+		moveMap.insert(move.depth) = move;
 	}
 
 	return true;
 }
 
-bool Converter::Process::SAMWriter::writeObjectMoveV1(
-	Frame::ObjectMove &move, const Frame::ObjectMove &prev)
+void Converter::Process::SAMWriter::applyObjectMoves()
 {
-	Q_ASSERT(move.depth <= DEPTHV1_MAX);
-	quint16 depthAndFlags = move.depth & DEPTHV1_MASK;
+	// Same depth states as written by writeObjectMoves()
+	for (Timeline::ObjectMove &move : moves)
+	{
+		Timeline::ObjectMove prev;
+
+		auto prevMove = moveMap.find(move.depth);
+
+		if (nullptr != prevMove)
+			prev = *prevMove;
+
+		resolveObjectMove(move, prev);
+		moveMap.insert(move.depth) = move;
+	}
+}
+
+void Converter::Process::SAMWriter::updateDisplayList()
+{
+	for (quint16 depth : removes)
+	{
+		displayList.erase(depth);
+	}
 
+	for (const Timeline::ObjectAdd &add : adds)
+	{
+		displayList.insert(add.depth) = add.shapeId;
+	}
+}
+
+void Converter::Process::SAMWriter::resolveObjectMove(
+	Timeline::ObjectMove &move, const Timeline::ObjectMove &prev)
+{
 	if (0 == (move.flags & PF_MATRIX))
 	{
 		move.matrix = prev.matrix;
@@ -2087,6 +4178,15 @@ bool Converter::Process::SAMWriter::writeObjectMoveV1(
 		move.multColor = prev.multColor;
 		move.addColor = prev.addColor;
 	}
+}
+
+bool Converter::Process::SAMWriter::writeObjectMoveV1(
+	Timeline::ObjectMove &move, const Timeline::ObjectMove &prev)
+{
+	Q_ASSERT(move.depth <= DEPTHV1_MAX);
+	quint16 depthAndFlags = move.depth & DEPTHV1_MASK;
+
+	resolveObjectMove(move, prev);
 
 	if (move.matrix.sx != 65536 || move.matrix.sy != 65536 ||
 		move.matrix.r0 != 0 || move.matrix.r1 != 0)
@@ -2150,26 +4250,17 @@ bool Converter::Process::SAMWriter::writeObjectMoveV1(
 }
 
 bool Converter::Process::SAMWriter::writeObjectMoveV2(
-	Frame::ObjectMove &move, const Frame::ObjectMove &prev)
+	Timeline::ObjectMove &move, const Timeline::ObjectMove &prev)
 {
 	Q_ASSERT(move.depth <= DEPTHV2_MAX);
 	quint16 depthAndFlags = move.depth & DEPTHV2_MASK;
 
 	int scaledX = 0, scaledY = 0;
 
-	if (0 == (move.flags & PF_MATRIX))
-	{
-		move.matrix = prev.matrix;
-	}
-
-	if (0 == (move.flags & PF_CXFORM))
-	{
-		move.multColor = prev.multColor;
-		move.addColor = prev.addColor;
-	}
+	resolveObjectMove(move, prev);
 
 	{
-		Frame::ObjectMove temp;
+		Timeline::ObjectMove temp;
 
 		if (0 == (move.flags & PF_CHAR))
 			temp = prev;
@@ -2238,7 +4329,98 @@ bool Converter::Process::SAMWriter::writeObjectMoveV2(
 	return outputStreamOk();
 }
 
-bool Converter::Process::SAMWriter::writeFrameLabel(const Frame &frame)
+bool Converter::Process::SAMWriter::writeObjectMoveV4(
+	Timeline::ObjectMove &move, const Timeline::ObjectMove &prev)
+{
+	Q_ASSERT(move.depth <= DEPTHV2_MAX);
+	quint16 depthAndFlags = move.depth & DEPTHV2_MASK;
+
+	resolveObjectMove(move, prev);
+
+	// Player keeps quantized values, so deltas are taken between them
+	int shift = 16 - owner.owner->mMatrixPrecision;
+	qint32 transform[4];
+	qint32 prevTransform[4];
+	int scaledX = 0, scaledY = 0;
+	int prevScaledX = 0, prevScaledY = 0;
+
+	{
+		Timeline::ObjectMove temp;
+
+		if (0 == (move.flags & PF_CHAR))
+			temp = prev;
+
+		transform[0] = quantizeFixed(move.matrix.sx, shift);
+		transform[1] = quantizeFixed(move.matrix.r1, shift);
+		transform[2] = quantizeFixed(move.matrix.r0, shift);
+		transform[3] = quantizeFixed(move.matrix.sy, shift);
+
+		prevTransform[0] = quantizeFixed(temp.matrix.sx, shift);
+		prevTransform[1] = quantizeFixed(temp.matrix.r1, shift);
+		prevTransform[2] = quantizeFixed(temp.matrix.r0, shift);
+		prevTransform[3] = quantizeFixed(temp.matrix.sy, shift);
+
+		scaledX = owner.scale(move.matrix.tx, CEIL);
+		scaledY = owner.scale(move.matrix.ty, CEIL);
+		prevScaledX = owner.scale(temp.matrix.tx, CEIL);
+		prevScaledY = owner.scale(temp.matrix.ty, CEIL);
+
+		if (move.flags & (PF_MATRIX | PF_CHAR))
+		{
+			if (0 != memcmp(transform, prevTransform, sizeof(transform)))
+				depthAndFlags |= MOVEFLAGSV2_TRANSFORM;
+
+			if (scaledX != prevScaledX || scaledY != prevScaledY)
+				depthAndFlags |= MOVEFLAGSV2_COORDS;
+		}
+
+		if (move.flags & (PF_CXFORM | PF_CHAR))
+		{
+			if (0 != memcmp(&move.multColor, &temp.multColor, sizeof(RGBA)))
+				depthAndFlags |= MOVEFLAGSV2_MULTCOLOR;
+
+			if (0 != memcmp(&move.addColor, &temp.addColor, sizeof(RGBA)))
+				depthAndFlags |= MOVEFLAGSV2_ADDCOLOR;
+		}
+	}
+
+	stream << depthAndFlags;
+
+	if (depthAndFlags & MOVEFLAGSV2_TRANSFORM)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			stream.writeVarInt(transform[i] - prevTransform[i]);
+		}
+	}
+
+	if (depthAndFlags & MOVEFLAGSV2_COORDS)
+	{
+		stream.writeVarInt(scaledX - prevScaledX);
+		stream.writeVarInt(scaledY - prevScaledY);
+	}
+
+	if (depthAndFlags & MOVEFLAGSV2_MULTCOLOR)
+	{
+		stream << move.multColor.r;
+		stream << move.multColor.g;
+		stream << move.multColor.b;
+		stream << move.multColor.a;
+	}
+
+	if (depthAndFlags & MOVEFLAGSV2_ADDCOLOR)
+	{
+		stream << move.addColor.r;
+		stream << move.addColor.g;
+		stream << move.addColor.b;
+		stream << move.addColor.a;
+	}
+
+	return outputStreamOk();
+}
+
+bool Converter::Process::SAMWriter::writeFrameLabel(
+	const Timeline::Frame &frame)
 {
 	auto &labelName = frame.labelName;
 
@@ -2248,9 +4430,10 @@ bool Converter::Process::SAMWriter::writeFrameLabel(const Frame &frame)
 	return writeString(labelName);
 }
 
-bool Converter::Process::SAMWriter::writeFrameFlags(const Frame &frame)
+bool Converter::Process::SAMWriter::writeFrameFlags(
+	const Timeline::Frame &frame, bool keyframe)
 {
-	quint8 flags = 0;
+	quint8 flags = keyframe ? FRAMEFLAGS_KEYFRAME : 0;
 
 	if (not removes.empty())
 		flags |= FRAMEFLAGS_REMOVES;
@@ -2271,14 +4454,17 @@ bool Converter::Process::SAMWriter::writeFrameFlags(const Frame &frame)
 
 bool Converter::Process::SAMWriter::writeFrameCount()
 {
-	stream << quint16(owner.swf.frameCount);
+	if (isSeekable())
+		stream << quint32(owner.swf.frameCount);
+	else
+		stream << quint16(owner.swf.frameCount);
 
 	return outputStreamOk();
 }
 
 bool Converter::Process::SAMWriter::outputStreamOk()
 {
-	if (stream.status() == QDataStream::Ok)
+	if (stream.ok())
 		return true;
 
 	owner.result = OUTPUT_FILE_WRITE_ERROR;
@@ -2286,12 +4472,23 @@ bool Converter::Process::SAMWriter::outputStreamOk()
 }
 
 Converter::Process::Process(Converter *owner)
-	: owner(owner)
-	, currentFrame(nullptr)
+	: log(owner->mBufferedLog)
+	, shapes(arenaLease.arena())
+	, timeline(arenaLease.arena())
+	, shapeRefs(arenaLease.arena())
+	, imageMap(arenaLease.arena())
+	, shapeRefMap(arenaLease.arena())
+	, shapeImages(arenaLease.arena())
+	, owner(owner)
 	, jpegTables(nullptr)
+	, firstPendingImage(0)
+	, currentScale(owner->mScale)
+	, ownerId(ImageDeduplicator::newOwnerId())
 	, result(OK)
 	, firstDepth(65535)
 	, depthMultiplier(0)
+	, multiScale(not owner->mScales.empty())
+	, inputOpened(false)
 {
 	memset(&swf, 0, sizeof(SWF));
 
@@ -2299,6 +4496,8 @@ Converter::Process::Process(Converter *owner)
 	{
 		case SAM_VERSION_1:
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			break;
 
 		default:
@@ -2306,25 +4505,175 @@ Converter::Process::Process(Converter *owner)
 			return;
 	}
 
-	if (owner->mScale <= 0.1)
+	if (owner->mKeyframeInterval < 0 || owner->mKeyframeInterval > 0xFFFF)
+	{
+		result = BAD_KEYFRAME_INTERVAL;
+		return;
+	}
+
+	if (owner->mMatrixPrecision < 0 || owner->mMatrixPrecision > 16)
+	{
+		result = BAD_MATRIX_PRECISION;
+		return;
+	}
+
+	if (not owner->mSamCompressor.isValid())
+	{
+		result = BAD_SAM_COMPRESSION;
+		return;
+	}
+
+	if (owner->mAtlas)
+	{
+		if (owner->mSamVersion == SAM_VERSION_1)
+		{
+			result = UNSUPPORTED_ATLAS;
+			return;
+		}
+
+		if (not TextureAtlas::isPowerOfTwo(owner->mAtlasPageSize) ||
+			owner->mAtlasPadding < 0 || owner->mAtlasExtrude < 0)
+		{
+			result = BAD_ATLAS_OPTIONS;
+			return;
+		}
+	}
+
+	if (multiScale)
+	{
+		// Larger scales go first, so smaller ones continue their mip chains
+		scales = owner->mScales;
+		std::sort(scales.begin(), scales.end(), std::greater<qreal>());
+		scales.erase(std::unique(scales.begin(), scales.end()), scales.end());
+		currentScale = scales.front();
+	} else
+	{
+		scales.push_back(owner->mScale);
+	}
+
+	if (scales.back() <= 0.1)
 	{
 		result = BAD_SCALE_VALUE;
 		return;
 	}
 
-	prefix = owner->outputFilePath(QFileInfo(owner->mInputFilePath).baseName());
+	prefix = prefixForScale(currentScale);
+
+	if (not owner->mImageCacheDirPath.isEmpty())
+	{
+		imageCache.reset(new ImageCache(owner->mImageCacheDirPath));
+	}
+
+	auto profiler = owner->mProfiler.get();
+	auto subject = QFileInfo(owner->mInputFilePath).fileName();
+
+	if (owner->mStreaming)
+	{
+		Profiler::Scope scope(profiler, "swf.stream", subject);
+		streamSWF();
+	} else
+	{
+		Profiler::Scope readScope(profiler, "swf.read", subject);
+		bool ok = readSWF();
+		readScope.setBytes(swf.fileSize);
+		readScope.finish();
+
+		if (ok)
+		{
+			Profiler::Scope parseScope(profiler, "swf.parse", subject);
+			parseSWF();
+		}
+	}
+
+	{
+		// Image jobs reference tag data, so always wait for them
+		Profiler::Scope waitScope(profiler, "images.wait", subject);
+
+		if (not waitForImages())
+			return;
+	}
+
+	for (size_t i = 0; i < scales.size(); i++)
+	{
+		if (not exportScale(i))
+			return;
+	}
+}
+
+bool Converter::Process::exportScale(size_t scaleIndex)
+{
+	auto profiler = owner->mProfiler.get();
+	auto subject = QFileInfo(owner->mInputFilePath).fileName();
+
+	if (multiScale)
+	{
+		currentScale = scales.at(scaleIndex);
+		prefix = prefixForScale(currentScale);
+		subject = QFileInfo(prefix).fileName();
+
+		Profiler::Scope scaleScope(profiler, "images.scale", subject);
+
+		if (not exportScaledImages(scaleIndex))
+			return false;
+	}
+
+	deduplicateImages();
+
+	if (owner->mAtlas)
+	{
+		Profiler::Scope atlasScope(profiler, "atlas", subject);
+
+		if (not packAtlas())
+			return false;
+	} else
+	{
+		auto suffix = owner->mImageEncoder.fileSuffix();
+
+		for (const Image &image : images)
+		{
+			// Aliases reference files of other images
+			if (image.sourceIndex == image.index)
+				outputs.append(image.filePathForPrefix(imagePrefix(), suffix));
+		}
+	}
+
+	if (not exportSAM())
+		return false;
 
-	readSWF() && parseSWF() && exportSAM();
+	outputs.append(prefix + ".sam");
+	return true;
 }
 
 Converter::Process::~Process()
 {
+	for (auto tag : retainedTags)
+	{
+		StreamSWFReader::freeTag(tag);
+	}
+
+	if (mappedReader)
+		MappedSWFReader::freeTags(&swf);
+
 	swf_FreeTags(&swf);
 }
 
 int Converter::Process::scale(int value, int mode) const
 {
-	return owner->scale(value, mode);
+	qreal v = value * currentScale;
+
+	switch (mode)
+	{
+		case FLOOR:
+			return qFloor(v);
+
+		case CEIL:
+			return qCeil(v);
+
+		default:
+			break;
+	}
+
+	return int(v);
 }
 
 size_t Converter::Process::maxDisplayCount() const
@@ -2335,6 +4684,8 @@ size_t Converter::Process::maxDisplayCount() const
 			return 0xFF;
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			return 0xFFFF;
 	}
 
@@ -2349,6 +4700,8 @@ size_t Converter::Process::maxDepth() const
 			return DEPTHV1_MAX;
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			return DEPTHV2_MAX;
 	}
 
@@ -2363,13 +4716,15 @@ size_t Converter::Process::maxShape() const
 			return 0xFF;
 
 		case SAM_VERSION_2:
+		case SAM_VERSION_3:
+		case SAM_VERSION_4:
 			return 0xFFFF;
 	}
 
 	return 0;
 }
 
-Frame::ObjectMove::ObjectMove()
+Timeline::ObjectMove::ObjectMove()
 	: depth(0)
 	, flags(0)
 {
@@ -6,10 +6,24 @@
 
 #pragma once
 
+#include "ImageEncoder.h"
+#include "ImageResampler.h"
+#include "SAMCompressor.h"
+
+#include <QByteArray>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 
 #include <map>
+#include <memory>
+#include <vector>
+
+class BuildManifest;
+class ConverterSink;
+class ImageDeduplicator;
+class Profiler;
+class QIODevice;
 
 class Converter
 {
@@ -36,26 +50,97 @@ public:
 		CONFIG_OPEN_ERROR,
 		CONFIG_PARSE_ERROR,
 		BAD_SCALE_VALUE,
-		BAD_SAM_VERSION
+		BAD_SAM_VERSION,
+		UNSUPPORTED_ATLAS,
+		BAD_ATLAS_OPTIONS,
+		BAD_KEYFRAME_INTERVAL,
+		BAD_MATRIX_PRECISION,
+		BAD_SAM_COMPRESSION,
+		ATLAS_IMAGE_TOO_LARGE
+	};
+
+	enum
+	{
+		DEFAULT_ATLAS_PAGE_SIZE = 2048,
+		DEFAULT_ATLAS_PADDING = 2,
+		DEFAULT_ATLAS_EXTRUDE = 1,
+		DEFAULT_KEYFRAME_INTERVAL = 30,
+		DEFAULT_MATRIX_PRECISION = 16
 	};
 
 	Converter();
 
 	using LabelRenameMap = std::map<QString, QString>;
+	using Scales = std::vector<qreal>;
 
 	void setSkipUnsupported(bool skip);
+	void setStreaming(bool enabled);
 	void setScale(qreal value);
+
+	// Export one SAM-file per scale parsing SWF and decoding images once.
+	// Output names get '@<scale>x' suffix. Overrides setScale() value
+	// if not empty.
+	void setScales(const Scales &value);
 	void setSamVersion(int value);
 	void setLabelRenameMap(const LabelRenameMap &value);
 	void setInputFilePath(const QString &path);
 	void setOutputDirPath(const QString &path);
 
+	// Read SWF from memory or a device instead of the input file.
+	// Input file path is still used to name the output.
+	// An open device is left open, otherwise it is opened for reading
+	// and closed after conversion.
+	void setInputData(const QByteArray &data);
+	void setInputDevice(QIODevice *device);
+
+	// Pass SAM and images to the sink instead of the output directory.
+	// Image cache and deduplication are not used with a sink.
+	void setSink(const std::shared_ptr<ConverterSink> &sink);
+	void setImageCacheDirPath(const QString &path);
+	void setImageEncoder(const ImageEncoder &encoder);
+	void setImageResampler(const ImageResampler &resampler);
+	void setAtlas(bool enabled);
+	void setAtlasPageSize(int size);
+	void setAtlasPadding(int padding);
+	void setAtlasExtrude(int extrude);
+
+	// SAM version 3 writes a full display list every interval frames,
+	// zero means the first frame only
+	void setKeyframeInterval(int interval);
+
+	// Fraction bits of object matrices kept by SAM version 4,
+	// from 0 to 16. Lower precision makes smaller move deltas.
+	void setMatrixPrecision(int bits);
+
+	// Write SAM-files in a compressed envelope if the method is not NONE
+	void setSamCompressor(const SAMCompressor &compressor);
+	void setImageDeduplicator(
+		const std::shared_ptr<ImageDeduplicator> &deduplicator);
+	void setProfiler(const std::shared_ptr<Profiler> &profiler);
+
+	// Skip conversion if the manifest written next to the SAM-file
+	// matches input contents, options and converter version.
+	// With trustModificationTime unchanged input size and modification
+	// time are enough to skip without hashing the input.
+	void setIncremental(bool enabled, bool trustModificationTime = false);
+
+	// Keep written file names and labels in log() instead of printing
+	// them, so concurrent conversions do not interleave their output
+	void setBufferedLog(bool enabled);
+
 	void loadConfig(const QString &configFilePath);
 	void loadConfigJson(const QByteArray &json);
 
 	int exec();
 	inline int result() const;
 	inline const QVariant &errorInfo() const;
+	inline const ImageEncoder &imageEncoder() const;
+	inline const ImageResampler &imageResampler() const;
+	inline const SAMCompressor &samCompressor() const;
+	inline const std::shared_ptr<ImageDeduplicator> &
+	imageDeduplicator() const;
+	inline bool skipped() const;
+	inline const QStringList &log() const;
 	static QString tagName(const QVariant &t);
 	static QString tagName(quint16 t);
 	static QString fillStyleToStr(int value);
@@ -72,13 +157,17 @@ public:
 
 	inline const Warnings &warnings() const;
 
-private:
 	static QString warnMessage(const Warning &warn);
 
+private:
 	struct Process;
 	friend struct Process;
 
 	QString outputFilePath(const QString &fileName) const;
+	QString samFilePath() const;
+	QByteArray optionsHash() const;
+	bool upToDate(BuildManifest *current) const;
+	void saveManifest(BuildManifest &manifest, const QStringList &outputs);
 
 	enum
 	{
@@ -86,17 +175,37 @@ private:
 		CEIL
 	};
 
-	int scale(int value, int mode) const;
-
 	Warnings mWarnings;
 	QVariant mErrorInfo;
 	QString mInputFilePath;
 	QString mOutputDirPath;
+	QString mImageCacheDirPath;
+	QByteArray mInputData;
+	QIODevice *mInputDevice;
+	std::shared_ptr<ConverterSink> mSink;
+	ImageEncoder mImageEncoder;
+	ImageResampler mImageResampler;
+	SAMCompressor mSamCompressor;
+	std::shared_ptr<ImageDeduplicator> mImageDeduplicator;
+	std::shared_ptr<Profiler> mProfiler;
 	LabelRenameMap mLabelRenameMap;
+	QStringList mLog;
+	Scales mScales;
 	qreal mScale;
 	int mSamVersion;
 	int mResult;
 	bool mSkipUnsupported;
+	bool mStreaming;
+	bool mAtlas;
+	bool mIncremental;
+	bool mTrustModificationTime;
+	bool mSkipped;
+	bool mBufferedLog;
+	int mAtlasPageSize;
+	int mAtlasPadding;
+	int mAtlasExtrude;
+	int mKeyframeInterval;
+	int mMatrixPrecision;
 };
 
 inline void Converter::setSkipUnsupported(bool skip)
@@ -104,11 +213,21 @@ inline void Converter::setSkipUnsupported(bool skip)
 	mSkipUnsupported = skip;
 }
 
+inline void Converter::setStreaming(bool enabled)
+{
+	mStreaming = enabled;
+}
+
 inline void Converter::setScale(qreal value)
 {
 	mScale = value;
 }
 
+inline void Converter::setScales(const Scales &value)
+{
+	mScales = value;
+}
+
 inline void Converter::setSamVersion(int value)
 {
 	mSamVersion = value;
@@ -129,6 +248,94 @@ inline void Converter::setOutputDirPath(const QString &path)
 	mOutputDirPath = path;
 }
 
+inline void Converter::setInputData(const QByteArray &data)
+{
+	mInputData = data;
+}
+
+inline void Converter::setInputDevice(QIODevice *device)
+{
+	mInputDevice = device;
+}
+
+inline void Converter::setSink(const std::shared_ptr<ConverterSink> &sink)
+{
+	mSink = sink;
+}
+
+inline void Converter::setImageCacheDirPath(const QString &path)
+{
+	mImageCacheDirPath = path;
+}
+
+inline void Converter::setImageEncoder(const ImageEncoder &encoder)
+{
+	mImageEncoder = encoder;
+}
+
+inline void Converter::setImageResampler(const ImageResampler &resampler)
+{
+	mImageResampler = resampler;
+}
+
+inline void Converter::setAtlas(bool enabled)
+{
+	mAtlas = enabled;
+}
+
+inline void Converter::setAtlasPageSize(int size)
+{
+	mAtlasPageSize = size;
+}
+
+inline void Converter::setAtlasPadding(int padding)
+{
+	mAtlasPadding = padding;
+}
+
+inline void Converter::setAtlasExtrude(int extrude)
+{
+	mAtlasExtrude = extrude;
+}
+
+inline void Converter::setKeyframeInterval(int interval)
+{
+	mKeyframeInterval = interval;
+}
+
+inline void Converter::setMatrixPrecision(int bits)
+{
+	mMatrixPrecision = bits;
+}
+
+inline void Converter::setSamCompressor(const SAMCompressor &compressor)
+{
+	mSamCompressor = compressor;
+}
+
+inline void Converter::setImageDeduplicator(
+	const std::shared_ptr<ImageDeduplicator> &deduplicator)
+{
+	mImageDeduplicator = deduplicator;
+}
+
+inline void Converter::setProfiler(const std::shared_ptr<Profiler> &profiler)
+{
+	mProfiler = profiler;
+}
+
+inline void Converter::setIncremental(
+	bool enabled, bool trustModificationTime)
+{
+	mIncremental = enabled;
+	mTrustModificationTime = trustModificationTime;
+}
+
+inline void Converter::setBufferedLog(bool enabled)
+{
+	mBufferedLog = enabled;
+}
+
 int Converter::result() const
 {
 	return mResult;
@@ -139,6 +346,36 @@ const QVariant &Converter::errorInfo() const
 	return mErrorInfo;
 }
 
+const ImageEncoder &Converter::imageEncoder() const
+{
+	return mImageEncoder;
+}
+
+const ImageResampler &Converter::imageResampler() const
+{
+	return mImageResampler;
+}
+
+const SAMCompressor &Converter::samCompressor() const
+{
+	return mSamCompressor;
+}
+
+const std::shared_ptr<ImageDeduplicator> &Converter::imageDeduplicator() const
+{
+	return mImageDeduplicator;
+}
+
+bool Converter::skipped() const
+{
+	return mSkipped;
+}
+
+const QStringList &Converter::log() const
+{
+	return mLog;
+}
+
 const Converter::Warnings &Converter::warnings() const
 {
 	return mWarnings;
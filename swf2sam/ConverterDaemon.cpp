@@ -0,0 +1,292 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ConverterDaemon.h"
+
+#include "ImageDeduplicator.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QtConcurrent>
+
+ConverterDaemon::ConverterDaemon()
+	: mActiveJobs(0)
+{
+	QObject::connect(&mServer, &QLocalServer::newConnection, &mServer,
+		[this]() { acceptConnection(); });
+}
+
+ConverterDaemon::~ConverterDaemon()
+{
+	mServer.close();
+	mPool.waitForDone();
+}
+
+void ConverterDaemon::setConverter(const Converter &prototype)
+{
+	mPrototype = prototype;
+}
+
+void ConverterDaemon::setThreadCount(int count)
+{
+	if (count > 0)
+		mPool.setMaxThreadCount(count);
+}
+
+bool ConverterDaemon::listen(const QString &name)
+{
+	mName = name;
+
+	if (mServer.listen(name))
+		return true;
+
+	if (mServer.serverError() != QAbstractSocket::AddressInUseError)
+		return false;
+
+	// Do not take the socket of a running daemon
+	QLocalSocket probe;
+	probe.connectToServer(name);
+
+	if (probe.waitForConnected(1000))
+	{
+		probe.disconnectFromServer();
+		return false;
+	}
+
+	// Remove a socket left by a crashed daemon
+	QLocalServer::removeServer(name);
+
+	return mServer.listen(name);
+}
+
+QString ConverterDaemon::errorMessage() const
+{
+	return QString("Unable to listen '%1' (%2).")
+		.arg(mName, mServer.errorString());
+}
+
+void ConverterDaemon::acceptConnection()
+{
+	while (mServer.hasPendingConnections())
+	{
+		auto socket = mServer.nextPendingConnection();
+
+		QObject::connect(socket, &QLocalSocket::readyRead, socket,
+			[this, socket]() { readRequests(socket); });
+		QObject::connect(socket, &QLocalSocket::disconnected, socket,
+			&QObject::deleteLater);
+	}
+}
+
+void ConverterDaemon::readRequests(QLocalSocket *socket)
+{
+	while (socket->canReadLine())
+	{
+		auto line = socket->readLine().trimmed();
+
+		if (not line.isEmpty())
+			handleRequest(socket, line);
+	}
+}
+
+void ConverterDaemon::handleRequest(
+	QLocalSocket *socket, const QByteArray &line)
+{
+	QJsonParseError parseError;
+	auto doc = QJsonDocument::fromJson(line, &parseError);
+
+	QJsonObject response;
+
+	if (parseError.error != QJsonParseError::NoError or not doc.isObject())
+	{
+		response.insert("event", QStringLiteral("error"));
+		response.insert("error", QStringLiteral("Malformed request."));
+		reply(socket, response);
+		return;
+	}
+
+	auto request = doc.object();
+	auto command = request.value(QLatin1String("command")).toString();
+
+	if (command == QLatin1String("quit"))
+	{
+		mServer.close();
+		QCoreApplication::quit();
+		return;
+	}
+
+	Job job;
+	QString error;
+
+	if (not command.isEmpty() || not prepareJob(request, job, &error))
+	{
+		if (error.isEmpty())
+			error = QString("Unknown command '%1'.").arg(command);
+
+		response.insert("id", request.value(QLatin1String("id")));
+		response.insert("event", QStringLiteral("error"));
+		response.insert("error", error);
+		reply(socket, response);
+		return;
+	}
+
+	response.insert("id", job.id);
+	response.insert("event", QStringLiteral("accepted"));
+	reply(socket, response);
+
+	runJob(socket, job);
+}
+
+bool ConverterDaemon::prepareJob(
+	const QJsonObject &request, Job &job, QString *error)
+{
+	job.id = request.value(QLatin1String("id"));
+	job.converter = mPrototype;
+
+	auto &cvt = job.converter;
+
+	auto input = request.value(QLatin1String("input"));
+
+	if (not input.isString())
+	{
+		*error = QStringLiteral("Input SWF-file path is not specified.");
+		return false;
+	}
+
+	cvt.setInputFilePath(input.toString());
+
+	auto output = request.value(QLatin1String("output"));
+
+	if (output.isString())
+		cvt.setOutputDirPath(output.toString());
+
+	// Explicit request fields override the configuration
+	auto configFile = request.value(QLatin1String("config_file"));
+
+	if (configFile.isString())
+		cvt.loadConfig(configFile.toString());
+
+	auto config = request.value(QLatin1String("config"));
+
+	if (config.isObject())
+		cvt.loadConfigJson(QJsonDocument(config.toObject()).toJson());
+
+	auto scale = request.value(QLatin1String("scale"));
+
+	if (scale.isDouble())
+	{
+		cvt.setScale(scale.toDouble());
+		cvt.setScales(Converter::Scales());
+	}
+
+	auto scales = request.value(QLatin1String("scales"));
+
+	if (scales.isArray())
+	{
+		Converter::Scales values;
+
+		for (auto value : scales.toArray())
+		{
+			values.push_back(value.toDouble());
+		}
+
+		cvt.setScales(values);
+	}
+
+	auto samVersion = request.value(QLatin1String("sam_version"));
+
+	if (samVersion.isDouble())
+		cvt.setSamVersion(samVersion.toInt());
+
+	auto skipUnsupported = request.value(QLatin1String("skip_unsupported"));
+
+	if (skipUnsupported.isBool())
+		cvt.setSkipUnsupported(skipUnsupported.toBool());
+
+	auto streaming = request.value(QLatin1String("streaming"));
+
+	if (streaming.isBool())
+		cvt.setStreaming(streaming.toBool());
+
+	return true;
+}
+
+void ConverterDaemon::runJob(QLocalSocket *socket, const Job &job)
+{
+	using Result = QJsonObject;
+
+	// Watcher outlives a disconnected socket to count finished jobs
+	auto watcher = new QFutureWatcher<Result>(&mServer);
+	QPointer<QLocalSocket> socketPtr(socket);
+
+	mActiveJobs++;
+
+	QObject::connect(watcher, &QFutureWatcher<Result>::finished, watcher,
+		[this, watcher, socketPtr]() {
+			if (socketPtr)
+				reply(socketPtr, watcher->result());
+
+			watcher->deleteLater();
+
+			// Images are forgotten when idle, so the registry does not
+			// grow during the daemon lifetime
+			auto &deduplicator = mPrototype.imageDeduplicator();
+
+			if (--mActiveJobs == 0 && deduplicator)
+				deduplicator->clear();
+		});
+
+	watcher->setFuture(QtConcurrent::run(&mPool, [job]() -> Result {
+		Converter cvt(job.converter);
+		cvt.setBufferedLog(true);
+
+		// Report configuration errors instead of converting
+		int result = cvt.result();
+
+		if (result == Converter::OK)
+			result = cvt.exec();
+
+		// One block per job, so concurrent jobs do not interleave
+		if (not cvt.log().isEmpty())
+			qInfo().noquote() << cvt.log().join('\n');
+
+		QJsonArray warnings;
+
+		for (auto &warn : cvt.warnings())
+		{
+			warnings.append(Converter::warnMessage(warn));
+		}
+
+		Result response;
+		response.insert("id", job.id);
+		response.insert("event", QStringLiteral("finished"));
+		response.insert("result", result);
+
+		if (result != Converter::OK)
+		{
+			Converter::Warning error;
+			error.code = result;
+			error.info = cvt.errorInfo();
+
+			response.insert("error", Converter::warnMessage(error));
+		}
+
+		response.insert("warnings", warnings);
+
+		return response;
+	}));
+}
+
+void ConverterDaemon::reply(QLocalSocket *socket, const QJsonObject &obj)
+{
+	socket->write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+	socket->write("\n");
+}
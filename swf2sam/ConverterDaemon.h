@@ -0,0 +1,68 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include "Converter.h"
+
+#include <QJsonValue>
+#include <QLocalServer>
+#include <QThreadPool>
+
+class QJsonObject;
+class QLocalSocket;
+
+// Serves conversion jobs over a local socket.
+// Every request and reply is a single line JSON object.
+// Request: {
+//   "id": <echoed back>,
+//   "input": "<swf>", "output": "<dir>",
+//   "scale": 1, "sam_version": 2,
+//   "skip_unsupported": false, "streaming": false,
+//   "config": { <configuration file properties> },
+//   "config_file": "<json>"
+// }
+// or { "command": "quit" } to stop the daemon.
+// Explicit request fields override the configuration.
+// Replies: { "id": ..., "event": "accepted" } when the job is queued,
+// { "id": ..., "event": "finished", "result": <code>,
+//   "error": "<message>", "warnings": [ "<message>", ... ] }
+// when it is done, "error" is only there if the result is not zero,
+// { "event": "error", "error": "<message>" } for a malformed request.
+class ConverterDaemon
+{
+public:
+	ConverterDaemon();
+	~ConverterDaemon();
+
+	// Job options not specified in a request are taken from prototype
+	void setConverter(const Converter &prototype);
+	void setThreadCount(int count);
+
+	// Fails if another daemon is listening with the same name
+	bool listen(const QString &name);
+	QString errorMessage() const;
+
+private:
+	struct Job
+	{
+		QJsonValue id;
+		Converter converter;
+	};
+
+	void acceptConnection();
+	void readRequests(QLocalSocket *socket);
+	void handleRequest(QLocalSocket *socket, const QByteArray &line);
+	bool prepareJob(const QJsonObject &request, Job &job, QString *error);
+	void runJob(QLocalSocket *socket, const Job &job);
+
+	static void reply(QLocalSocket *socket, const QJsonObject &obj);
+
+	QLocalServer mServer;
+	QString mName;
+	QThreadPool mPool;
+	Converter mPrototype;
+	int mActiveJobs;
+};
@@ -0,0 +1,109 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ConverterSink.h"
+
+#include "Converter.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+
+ConverterSink::~ConverterSink()
+{
+}
+
+FileConverterSink::FileConverterSink(const QString &dirPath)
+	: mDirPath(dirPath)
+{
+}
+
+int FileConverterSink::saveFile(const QString &filePath, const QByteArray &data)
+{
+	if (not QDir().mkpath(QFileInfo(filePath).path()))
+	{
+		return Converter::OUTPUT_DIR_ERROR;
+	}
+
+	QSaveFile file(filePath);
+
+	if (not file.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		return Converter::OUTPUT_FILE_WRITE_ERROR;
+	}
+
+	if (file.write(data) != data.size() || not file.commit())
+	{
+		return Converter::OUTPUT_FILE_WRITE_ERROR;
+	}
+
+	return Converter::OK;
+}
+
+int FileConverterSink::writeImage(const QString &name, const QByteArray &data)
+{
+	return saveFile(QDir(mDirPath).filePath(name), data);
+}
+
+int FileConverterSink::writeSAM(const QString &name, const QByteArray &data)
+{
+	return saveFile(QDir(mDirPath).filePath(name), data);
+}
+
+int MemoryConverterSink::writeImage(
+	const QString &name, const QByteArray &data)
+{
+	QMutexLocker lock(&mMutex);
+
+	File file;
+	file.name = name;
+	file.data = data;
+	mImages.push_back(file);
+
+	return Converter::OK;
+}
+
+int MemoryConverterSink::writeSAM(const QString &name, const QByteArray &data)
+{
+	QMutexLocker lock(&mMutex);
+
+	mSAM.name = name;
+	mSAM.data = data;
+
+	return Converter::OK;
+}
+
+MemoryConverterSink::Files MemoryConverterSink::images() const
+{
+	Files result;
+
+	{
+		QMutexLocker lock(&mMutex);
+		result = mImages;
+	}
+
+	// Image export jobs finish in any order
+	std::sort(result.begin(), result.end(),
+		[](const File &a, const File &b) { return a.name < b.name; });
+
+	return result;
+}
+
+MemoryConverterSink::File MemoryConverterSink::sam() const
+{
+	QMutexLocker lock(&mMutex);
+
+	return mSAM;
+}
+
+void MemoryConverterSink::clear()
+{
+	QMutexLocker lock(&mMutex);
+
+	mImages.clear();
+	mSAM = File();
+}
@@ -0,0 +1,69 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+#include <vector>
+
+// Receives converted files instead of the output directory.
+// Names are relative paths like "name.sam" or "name/0000.png".
+// writeImage() is called concurrently from image export threads.
+// Both methods return Converter::OK or Converter error code.
+class ConverterSink
+{
+public:
+	virtual ~ConverterSink();
+
+	virtual int writeImage(const QString &name, const QByteArray &data) = 0;
+	virtual int writeSAM(const QString &name, const QByteArray &data) = 0;
+};
+
+// Writes files to a directory
+class FileConverterSink : public ConverterSink
+{
+public:
+	explicit FileConverterSink(const QString &dirPath);
+
+	static int saveFile(const QString &filePath, const QByteArray &data);
+
+	virtual int writeImage(
+		const QString &name, const QByteArray &data) override;
+	virtual int writeSAM(const QString &name, const QByteArray &data) override;
+
+private:
+	QString mDirPath;
+};
+
+// Keeps files in memory
+class MemoryConverterSink : public ConverterSink
+{
+public:
+	struct File
+	{
+		QString name;
+		QByteArray data;
+	};
+
+	using Files = std::vector<File>;
+
+	virtual int writeImage(
+		const QString &name, const QByteArray &data) override;
+	virtual int writeSAM(const QString &name, const QByteArray &data) override;
+
+	// Sorted by name
+	Files images() const;
+	File sam() const;
+
+	void clear();
+
+private:
+	mutable QMutex mMutex;
+	Files mImages;
+	File mSAM;
+};
@@ -0,0 +1,153 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ImageCache.h"
+
+#include "ImageEncoder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+ImageCache::ImageCache(const QString &dirPath)
+	: mDirPath(dirPath)
+{
+}
+
+bool ImageCache::fetch(const QByteArray &key, const QString &filePath,
+	int *width, int *height, QByteArray *info) const
+{
+	Q_ASSERT(nullptr != width);
+	Q_ASSERT(nullptr != height);
+
+	auto cachedFilePath =
+		entryFilePath(key, QFileInfo(filePath).completeSuffix());
+
+	auto size = ImageEncoder::imageSize(cachedFilePath);
+
+	if (not size.isValid())
+	{
+		// Missing or not an image file, so the size is unknown
+		return false;
+	}
+
+	if (nullptr != info)
+	{
+		QFile infoFile(entryFilePath(key, "info"));
+
+		if (infoFile.open(QFile::ReadOnly))
+		{
+			*info = infoFile.readAll();
+		} else
+		{
+			info->clear();
+		}
+	}
+
+	if (not linkOrCopy(cachedFilePath, filePath))
+		return false;
+
+	*width = size.width();
+	*height = size.height();
+	return true;
+}
+
+void ImageCache::store(const QByteArray &key, const QString &filePath,
+	const QByteArray &info) const
+{
+	auto cachedFilePath =
+		entryFilePath(key, QFileInfo(filePath).completeSuffix());
+	auto infoFilePath = entryFilePath(key, "info");
+
+	bool storeFile = not QFileInfo::exists(cachedFilePath);
+	bool storeInfo = not info.isEmpty() && not QFileInfo::exists(infoFilePath);
+
+	if (not storeFile && not storeInfo)
+		return;
+
+	if (not QDir().mkpath(QFileInfo(cachedFilePath).path()))
+		return;
+
+	// Other converters may store the same entry at the same time,
+	// so publish it with an atomic rename
+	auto tempSuffix = QUuid::createUuid().toString().mid(1, 36);
+
+	if (storeInfo)
+	{
+		// Info is published first, so it exists for every cached file
+		auto tempInfoFilePath =
+			QString("%1.%2.tmp").arg(infoFilePath, tempSuffix);
+
+		QFile infoFile(tempInfoFilePath);
+
+		if (not infoFile.open(QFile::WriteOnly | QFile::Truncate) ||
+			infoFile.write(info) != info.size())
+		{
+			infoFile.remove();
+			return;
+		}
+
+		infoFile.close();
+
+		if (not QFile::rename(tempInfoFilePath, infoFilePath))
+			QFile::remove(tempInfoFilePath);
+	}
+
+	if (not storeFile)
+		return;
+
+	auto tempFilePath = QString("%1.%2.tmp").arg(cachedFilePath, tempSuffix);
+
+	if (linkOrCopy(filePath, tempFilePath) &&
+		not QFile::rename(tempFilePath, cachedFilePath))
+	{
+		QFile::remove(tempFilePath);
+	}
+}
+
+bool ImageCache::linkOrCopy(
+	const QString &sourceFilePath, const QString &filePath)
+{
+	if (QFileInfo::exists(filePath) && not QFile::remove(filePath))
+		return false;
+
+#ifdef Q_OS_WIN
+	if (CreateHardLinkW(
+			reinterpret_cast<LPCWSTR>(
+				QDir::toNativeSeparators(filePath).utf16()),
+			reinterpret_cast<LPCWSTR>(
+				QDir::toNativeSeparators(sourceFilePath).utf16()),
+			nullptr))
+	{
+		return true;
+	}
+#else
+	if (0 ==
+		::link(QFile::encodeName(sourceFilePath).constData(),
+			QFile::encodeName(filePath).constData()))
+	{
+		return true;
+	}
+#endif
+
+	// Different volumes or file system without hard links
+	return QFile::copy(sourceFilePath, filePath);
+}
+
+QString ImageCache::entryFilePath(
+	const QByteArray &key, const QString &suffix) const
+{
+	auto hex = QString::fromLatin1(key.toHex());
+
+	return QDir(mDirPath).filePath(
+		QString("%1/%2.%3").arg(hex.left(2), hex, suffix));
+}
@@ -0,0 +1,43 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+
+// Persistent content-addressed storage of exported images.
+// Entries are keyed by a hash of everything the exported file depends on,
+// so an unchanged bitmap is hard-linked (or copied) from the cache
+// instead of being decoded, scaled and encoded again.
+class ImageCache
+{
+public:
+	explicit ImageCache(const QString &dirPath);
+
+	inline const QString &dirPath() const;
+
+	// Places cached file for the key to filePath.
+	// Returns false if there is no such entry.
+	// Optional info is a small blob stored along with the file.
+	bool fetch(const QByteArray &key, const QString &filePath, int *width,
+		int *height, QByteArray *info = nullptr) const;
+
+	void store(const QByteArray &key, const QString &filePath,
+		const QByteArray &info = QByteArray()) const;
+
+	static bool linkOrCopy(
+		const QString &sourceFilePath, const QString &filePath);
+
+private:
+	QString entryFilePath(const QByteArray &key, const QString &suffix) const;
+
+	QString mDirPath;
+};
+
+const QString &ImageCache::dirPath() const
+{
+	return mDirPath;
+}
@@ -0,0 +1,182 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ImageDeduplicator.h"
+
+#include "ImageCache.h"
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QImage>
+
+#include <memory>
+
+int ImageDeduplicator::newOwnerId()
+{
+	static QAtomicInt lastOwnerId;
+	return lastOwnerId.fetchAndAddRelaxed(1) + 1;
+}
+
+QByteArray ImageDeduplicator::pixelKey(const QImage &image, qreal scale)
+{
+	return pixelKeys(image, std::vector<qreal>(1, scale)).front();
+}
+
+std::vector<QByteArray> ImageDeduplicator::pixelKeys(
+	const QImage &image, const std::vector<qreal> &scales)
+{
+	// Equal pixels decoded from different tag types
+	// must produce the same key
+	auto format = QImage::Format_RGBA8888_Premultiplied;
+	QImage converted =
+		image.format() == format ? image : image.convertToFormat(format);
+
+	int width = converted.width();
+	int height = converted.height();
+
+	std::vector<std::unique_ptr<QCryptographicHash>> hashes;
+
+	for (qreal scale : scales)
+	{
+		hashes.emplace_back(new QCryptographicHash(QCryptographicHash::Sha1));
+
+		auto &hash = *hashes.back();
+		hash.addData(QByteArray::number(width));
+		hash.addData("x", 1);
+		hash.addData(QByteArray::number(height));
+		hash.addData("@", 1);
+		hash.addData(QByteArray::number(scale, 'g', 17));
+	}
+
+	int lineSize = width * 4;
+
+	for (int y = 0; y < height; y++)
+	{
+		auto line = reinterpret_cast<const char *>(converted.constScanLine(y));
+
+		for (auto &hash : hashes)
+		{
+			hash->addData(line, lineSize);
+		}
+	}
+
+	std::vector<QByteArray> result;
+	result.reserve(hashes.size());
+
+	for (auto &hash : hashes)
+	{
+		result.push_back(hash->result());
+	}
+
+	return result;
+}
+
+ImageDeduplicator::Claim ImageDeduplicator::claim(const QByteArray &key,
+	int ownerId, size_t index, const QString &filePath, size_t *aliasIndex)
+{
+	Q_ASSERT(nullptr != aliasIndex);
+
+	QMutexLocker lock(&mMutex);
+
+	auto it = mEntries.find(key);
+
+	if (it == mEntries.end())
+	{
+		// Reserve the entry until the image is encoded
+		Entry entry;
+		entry.ownerId = ownerId;
+		entry.index = index;
+		entry.fileSize = 0;
+		mEntries[key] = entry;
+		return ENCODE;
+	}
+
+	auto &entry = it->second;
+
+	if (entry.ownerId == ownerId)
+	{
+		if (entry.index < index)
+		{
+			*aliasIndex = entry.index;
+			return ALIAS;
+		}
+
+		// Lower index always wins to keep the output deterministic
+		entry.index = index;
+		entry.filePath.clear();
+		return ENCODE;
+	}
+
+	// Never wait for an image still being encoded by another conversion,
+	// the encoding threads are shared
+	if (entry.filePath.isEmpty())
+		return ENCODE;
+
+	auto source = entry;
+	lock.unlock();
+
+	// Published file may be deleted or replaced by a later conversion
+	QFileInfo sourceInfo(source.filePath);
+
+	if (sourceInfo.isFile() && sourceInfo.size() == source.fileSize &&
+		sourceInfo.lastModified() == source.lastModified &&
+		ImageCache::linkOrCopy(source.filePath, filePath))
+	{
+		return LINKED;
+	}
+
+	lock.relock();
+
+	it = mEntries.find(key);
+
+	if (it != mEntries.end() && it->second.filePath == source.filePath)
+	{
+		// Reserve the stale entry like a new one
+		auto &stale = it->second;
+		stale.ownerId = ownerId;
+		stale.index = index;
+		stale.filePath.clear();
+	}
+
+	return ENCODE;
+}
+
+void ImageDeduplicator::publish(const QByteArray &key, int ownerId,
+	size_t index, const QString &filePath)
+{
+	QFileInfo fileInfo(filePath);
+	auto fileSize = fileInfo.size();
+	auto lastModified = fileInfo.lastModified();
+
+	QMutexLocker lock(&mMutex);
+
+	auto it = mEntries.find(key);
+
+	if (it == mEntries.end())
+		return;
+
+	auto &entry = it->second;
+
+	if (not entry.filePath.isEmpty())
+		return;
+
+	// Images with a higher index of the same conversion
+	// will be replaced by an alias, so their files are not shared
+	if (entry.ownerId == ownerId && entry.index != index)
+		return;
+
+	entry.ownerId = ownerId;
+	entry.index = index;
+	entry.filePath = filePath;
+	entry.fileSize = fileSize;
+	entry.lastModified = lastModified;
+}
+
+void ImageDeduplicator::clear()
+{
+	QMutexLocker lock(&mMutex);
+	mEntries.clear();
+}
@@ -0,0 +1,63 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+
+#include <map>
+#include <vector>
+
+class QImage;
+
+// Thread-safe registry of exported images keyed by decoded pixel content.
+// Can be shared between conversions, so an image already exported
+// for another SWF-file is linked instead of being encoded again.
+class ImageDeduplicator
+{
+public:
+	enum Claim
+	{
+		ENCODE,
+		ALIAS,
+		LINKED
+	};
+
+	static int newOwnerId();
+	static QByteArray pixelKey(const QImage &image, qreal scale);
+
+	// Same as pixelKey() for every scale, pixels are read once
+	static std::vector<QByteArray> pixelKeys(
+		const QImage &image, const std::vector<qreal> &scales);
+
+	// ALIAS means the same conversion has an equal image with
+	// a lower index, stored to aliasIndex. LINKED means filePath
+	// was linked from an equal image of another conversion.
+	// Files deleted or replaced since publish() are not linked.
+	Claim claim(const QByteArray &key, int ownerId, size_t index,
+		const QString &filePath, size_t *aliasIndex);
+
+	void publish(const QByteArray &key, int ownerId, size_t index,
+		const QString &filePath);
+
+	// Forgets all images, long running users call it when idle
+	void clear();
+
+private:
+	struct Entry
+	{
+		int ownerId;
+		size_t index;
+		QString filePath;
+		qint64 fileSize;
+		QDateTime lastModified;
+	};
+
+	QMutex mMutex;
+	std::map<QByteArray, Entry> mEntries;
+};
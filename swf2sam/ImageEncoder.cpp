@@ -0,0 +1,503 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ImageEncoder.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const char RAW_Signature[] = "RAW.";
+static const char PNG_Signature[] = "\x89PNG\r\n\x1A\n";
+
+enum
+{
+	RAW_SIGN_SIZE = sizeof(RAW_Signature) - 1,
+	PNG_SIGN_SIZE = sizeof(PNG_Signature) - 1,
+	PNG_FILTER_COUNT = 5,
+	PNG_BIT_DEPTH = 8,
+	PNG_COLOR_RGB = 2,
+	PNG_COLOR_RGBA = 6
+};
+
+// All fields are little-endian
+struct RAW_Header
+{
+	char signature[RAW_SIGN_SIZE];
+	quint32 version;
+	quint32 width;
+	quint32 height;
+	quint32 flags;
+	quint32 dataSize;
+};
+
+template <typename T>
+struct NamedValue
+{
+	const char *name;
+	T value;
+};
+
+template <typename T, size_t N>
+static bool parseNamed(const NamedValue<T> (&values)[N], const QString &str,
+	T *result)
+{
+	Q_ASSERT(nullptr != result);
+
+	for (auto &v : values)
+	{
+		if (0 == str.compare(QLatin1String(v.name), Qt::CaseInsensitive))
+		{
+			*result = v.value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ImageEncoder::ImageEncoder()
+	: mFormat(PNG)
+	, mStrategy(STRATEGY_DEFAULT)
+	, mFilter(FILTER_DEFAULT)
+	, mCompressionLevel(DEFAULT_LEVEL)
+{
+}
+
+bool ImageEncoder::parseFormat(const QString &str, Format *format)
+{
+	static const NamedValue<Format> formats[] = {
+		{"png", PNG},
+		{"raw", RAW},
+#ifdef HAVE_LZ4
+		{"lz4", RAW_LZ4},
+#endif
+	};
+
+	return parseNamed(formats, str, format);
+}
+
+bool ImageEncoder::parseStrategy(const QString &str, Strategy *strategy)
+{
+	static const NamedValue<Strategy> strategies[] = {
+		{"default", STRATEGY_DEFAULT},
+		{"filtered", STRATEGY_FILTERED},
+		{"huffman", STRATEGY_HUFFMAN_ONLY},
+		{"rle", STRATEGY_RLE},
+		{"fixed", STRATEGY_FIXED},
+	};
+
+	return parseNamed(strategies, str, strategy);
+}
+
+bool ImageEncoder::parseFilter(const QString &str, Filter *filter)
+{
+	static const NamedValue<Filter> filters[] = {
+		{"default", FILTER_DEFAULT},
+		{"none", FILTER_NONE},
+		{"sub", FILTER_SUB},
+		{"up", FILTER_UP},
+		{"average", FILTER_AVERAGE},
+		{"paeth", FILTER_PAETH},
+		{"adaptive", FILTER_ADAPTIVE},
+	};
+
+	return parseNamed(filters, str, filter);
+}
+
+bool ImageEncoder::parseCompressionLevel(const QString &str, int *level)
+{
+	Q_ASSERT(nullptr != level);
+
+	bool ok;
+	int value = str.toInt(&ok);
+
+	if (not ok || value < DEFAULT_LEVEL || value > MAX_LEVEL)
+		return false;
+
+	*level = value;
+	return true;
+}
+
+QSize ImageEncoder::imageSize(const QString &filePath)
+{
+	QFile file(filePath);
+
+	if (not file.open(QFile::ReadOnly))
+		return QSize();
+
+	RAW_Header header;
+
+	if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) ==
+			qint64(sizeof(header)) &&
+		0 == memcmp(header.signature, RAW_Signature, RAW_SIGN_SIZE))
+	{
+		return QSize(int(qFromLittleEndian(header.width)),
+			int(qFromLittleEndian(header.height)));
+	}
+
+	file.seek(0);
+
+	return QImageReader(&file).size();
+}
+
+QString ImageEncoder::fileSuffix() const
+{
+	switch (mFormat)
+	{
+		case PNG:
+			break;
+
+		case RAW:
+		case RAW_LZ4:
+			return QStringLiteral("raw");
+	}
+
+	return QStringLiteral("png");
+}
+
+QByteArray ImageEncoder::key() const
+{
+	return QString("%1:%2:%3:%4")
+		.arg(int(mFormat))
+		.arg(mCompressionLevel)
+		.arg(int(mStrategy))
+		.arg(int(mFilter))
+		.toLatin1();
+}
+
+bool ImageEncoder::encode(const QImage &image, QByteArray *output) const
+{
+	Q_ASSERT(nullptr != output);
+
+	switch (mFormat)
+	{
+		case PNG:
+			break;
+
+		case RAW:
+		case RAW_LZ4:
+			return encodeRaw(image, output);
+	}
+
+	if (usesQt())
+	{
+		QBuffer buffer(output);
+		buffer.open(QBuffer::WriteOnly);
+
+		return image.save(&buffer, "png");
+	}
+
+	return encodePng(image, output);
+}
+
+bool ImageEncoder::usesQt() const
+{
+	return mCompressionLevel == DEFAULT_LEVEL &&
+		mStrategy == STRATEGY_DEFAULT && mFilter == FILTER_DEFAULT;
+}
+
+static int zlibStrategy(ImageEncoder::Strategy strategy)
+{
+	switch (strategy)
+	{
+		case ImageEncoder::STRATEGY_DEFAULT:
+			break;
+
+		case ImageEncoder::STRATEGY_FILTERED:
+			return Z_FILTERED;
+
+		case ImageEncoder::STRATEGY_HUFFMAN_ONLY:
+			return Z_HUFFMAN_ONLY;
+
+		case ImageEncoder::STRATEGY_RLE:
+			return Z_RLE;
+
+		case ImageEncoder::STRATEGY_FIXED:
+			return Z_FIXED;
+	}
+
+	return Z_DEFAULT_STRATEGY;
+}
+
+static inline quint8 paethPredictor(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = std::abs(p - a);
+	int pb = std::abs(p - b);
+	int pc = std::abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return quint8(a);
+
+	if (pb <= pc)
+		return quint8(b);
+
+	return quint8(c);
+}
+
+// Writes filter type byte and filtered row to dst.
+// prev is nullptr for the first row.
+static void filterRow(int type, const quint8 *row, const quint8 *prev,
+	int rowBytes, int bpp, quint8 *dst)
+{
+	*dst++ = quint8(type);
+
+	for (int i = 0; i < rowBytes; i++)
+	{
+		int a = i >= bpp ? row[i - bpp] : 0;
+		int b = nullptr != prev ? prev[i] : 0;
+		int c = (i >= bpp && nullptr != prev) ? prev[i - bpp] : 0;
+		int x = row[i];
+
+		switch (type)
+		{
+			case 1:
+				x -= a;
+				break;
+
+			case 2:
+				x -= b;
+				break;
+
+			case 3:
+				x -= (a + b) >> 1;
+				break;
+
+			case 4:
+				x -= paethPredictor(a, b, c);
+				break;
+		}
+
+		dst[i] = quint8(x);
+	}
+}
+
+// Minimum sum of absolute differences heuristic from libpng
+static quint64 filteredRowCost(const quint8 *filtered, int rowBytes)
+{
+	quint64 cost = 0;
+
+	for (int i = 0; i < rowBytes; i++)
+	{
+		cost += quint64(std::abs(int(qint8(filtered[i]))));
+	}
+
+	return cost;
+}
+
+static void writePngChunk(
+	QByteArray *output, const char *type, const QByteArray &data)
+{
+	uchar length[4];
+	qToBigEndian(quint32(data.size()), length);
+	output->append(reinterpret_cast<const char *>(length), 4);
+
+	auto crcStart = output->size();
+	output->append(type, 4);
+	output->append(data);
+
+	uchar crc[4];
+	qToBigEndian(quint32(crc32(crc32(0, Z_NULL, 0),
+					 reinterpret_cast<const Bytef *>(
+						 output->constData() + crcStart),
+					 uInt(output->size() - crcStart))),
+		crc);
+	output->append(reinterpret_cast<const char *>(crc), 4);
+}
+
+bool ImageEncoder::encodePng(const QImage &source, QByteArray *output) const
+{
+	bool alpha = source.hasAlphaChannel();
+	auto image = source.convertToFormat(
+		alpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+
+	if (image.isNull())
+		return false;
+
+	int width = image.width();
+	int height = image.height();
+	int bpp = alpha ? 4 : 3;
+	int rowBytes = width * bpp;
+	int filteredRowBytes = rowBytes + 1;
+
+	std::vector<quint8> filtered(size_t(filteredRowBytes) * height);
+	std::vector<quint8> candidates;
+
+	if (mFilter == FILTER_ADAPTIVE || mFilter == FILTER_DEFAULT)
+		candidates.resize(size_t(filteredRowBytes) * PNG_FILTER_COUNT);
+
+	const quint8 *prev = nullptr;
+
+	for (int y = 0; y < height; y++)
+	{
+		auto row = image.constScanLine(y);
+		auto dst = &filtered[size_t(filteredRowBytes) * y];
+
+		if (candidates.empty())
+		{
+			filterRow(mFilter - FILTER_NONE, row, prev, rowBytes, bpp, dst);
+		} else
+		{
+			quint64 bestCost = 0;
+			int bestType = -1;
+
+			for (int type = 0; type < PNG_FILTER_COUNT; type++)
+			{
+				auto candidate = &candidates[size_t(filteredRowBytes) * type];
+				filterRow(type, row, prev, rowBytes, bpp, candidate);
+
+				auto cost = filteredRowCost(candidate + 1, rowBytes);
+
+				if (bestType < 0 || cost < bestCost)
+				{
+					bestCost = cost;
+					bestType = type;
+				}
+			}
+
+			memcpy(dst, &candidates[size_t(filteredRowBytes) * bestType],
+				size_t(filteredRowBytes));
+		}
+
+		prev = row;
+	}
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+
+	if (Z_OK !=
+		deflateInit2(&stream,
+			mCompressionLevel == DEFAULT_LEVEL ? Z_DEFAULT_COMPRESSION
+											   : mCompressionLevel,
+			Z_DEFLATED, MAX_WBITS, 8, zlibStrategy(mStrategy)))
+	{
+		return false;
+	}
+
+	QByteArray compressed(
+		int(deflateBound(&stream, uLong(filtered.size()))), Qt::Uninitialized);
+
+	stream.next_in = filtered.data();
+	stream.avail_in = uInt(filtered.size());
+	stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+	stream.avail_out = uInt(compressed.size());
+
+	int zresult = deflate(&stream, Z_FINISH);
+	compressed.resize(int(stream.total_out));
+	deflateEnd(&stream);
+
+	if (zresult != Z_STREAM_END)
+		return false;
+
+	QByteArray header(13, Qt::Uninitialized);
+	auto h = reinterpret_cast<uchar *>(header.data());
+	qToBigEndian(quint32(width), h);
+	qToBigEndian(quint32(height), h + 4);
+	h[8] = PNG_BIT_DEPTH;
+	h[9] = alpha ? PNG_COLOR_RGBA : PNG_COLOR_RGB;
+	h[10] = 0; // deflate
+	h[11] = 0; // adaptive filtering
+	h[12] = 0; // no interlace
+
+	output->clear();
+	output->reserve(PNG_SIGN_SIZE + compressed.size() + 64);
+	output->append(PNG_Signature, PNG_SIGN_SIZE);
+	writePngChunk(output, "IHDR", header);
+	writePngChunk(output, "IDAT", compressed);
+	writePngChunk(output, "IEND", QByteArray());
+
+	return true;
+}
+
+bool ImageEncoder::encodeRaw(const QImage &source, QByteArray *output) const
+{
+	auto image = source.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+	if (image.isNull())
+		return false;
+
+	int width = image.width();
+	int height = image.height();
+	int rowBytes = width * 4;
+	int pixelsSize = rowBytes * height;
+
+	RAW_Header header;
+	memcpy(header.signature, RAW_Signature, RAW_SIGN_SIZE);
+	header.version = qToLittleEndian(quint32(RAW_VERSION));
+	header.width = qToLittleEndian(quint32(width));
+	header.height = qToLittleEndian(quint32(height));
+
+	quint32 flags = RAW_FLAG_PREMULTIPLIED;
+
+	QByteArray pixels(pixelsSize, Qt::Uninitialized);
+
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(pixels.data() + rowBytes * y, image.constScanLine(y),
+			size_t(rowBytes));
+	}
+
+	switch (mFormat)
+	{
+		case PNG:
+			Q_UNREACHABLE();
+			return false;
+
+		case RAW:
+			break;
+
+		case RAW_LZ4:
+		{
+#ifdef HAVE_LZ4
+			LZ4F_preferences_t prefs;
+			memset(&prefs, 0, sizeof(prefs));
+			prefs.frameInfo.contentSize = quint64(pixelsSize);
+			prefs.compressionLevel =
+				mCompressionLevel == DEFAULT_LEVEL ? 0 : mCompressionLevel;
+
+			QByteArray compressed(
+				int(LZ4F_compressFrameBound(size_t(pixelsSize), &prefs)),
+				Qt::Uninitialized);
+
+			auto compressedSize = LZ4F_compressFrame(compressed.data(),
+				size_t(compressed.size()), pixels.constData(),
+				size_t(pixelsSize), &prefs);
+
+			if (LZ4F_isError(compressedSize))
+				return false;
+
+			compressed.resize(int(compressedSize));
+			pixels.swap(compressed);
+			flags |= RAW_FLAG_LZ4;
+			break;
+#else
+			return false;
+#endif
+		}
+	}
+
+	header.flags = qToLittleEndian(flags);
+	header.dataSize = qToLittleEndian(quint32(pixels.size()));
+
+	output->clear();
+	output->reserve(int(sizeof(header)) + pixels.size());
+	output->append(reinterpret_cast<const char *>(&header), sizeof(header));
+	output->append(pixels);
+
+	return true;
+}
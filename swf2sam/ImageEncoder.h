@@ -0,0 +1,142 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+
+class QImage;
+
+// Encodes exported images.
+// PNG is written by Qt unless compression level, strategy or filter
+// is specified. RAW format is a small header followed by premultiplied
+// RGBA8888 pixels ready for texture upload, optionally LZ4-framed.
+// Both RAW variants use .raw suffix, header flags tell them apart.
+class ImageEncoder
+{
+public:
+	enum Format
+	{
+		PNG,
+		RAW,
+		RAW_LZ4
+	};
+
+	enum Strategy
+	{
+		STRATEGY_DEFAULT,
+		STRATEGY_FILTERED,
+		STRATEGY_HUFFMAN_ONLY,
+		STRATEGY_RLE,
+		STRATEGY_FIXED
+	};
+
+	enum Filter
+	{
+		FILTER_DEFAULT,
+		FILTER_NONE,
+		FILTER_SUB,
+		FILTER_UP,
+		FILTER_AVERAGE,
+		FILTER_PAETH,
+		FILTER_ADAPTIVE
+	};
+
+	enum
+	{
+		DEFAULT_LEVEL = -1,
+		MAX_LEVEL = 9
+	};
+
+	enum
+	{
+		RAW_VERSION = 1
+	};
+
+	enum
+	{
+		RAW_FLAG_PREMULTIPLIED = 0x01,
+		RAW_FLAG_LZ4 = 0x02
+	};
+
+	ImageEncoder();
+
+	inline Format format() const;
+	inline int compressionLevel() const;
+	inline Strategy strategy() const;
+	inline Filter filter() const;
+
+	inline void setFormat(Format format);
+	inline void setCompressionLevel(int level);
+	inline void setStrategy(Strategy strategy);
+	inline void setFilter(Filter filter);
+
+	static bool parseFormat(const QString &str, Format *format);
+	static bool parseStrategy(const QString &str, Strategy *strategy);
+	static bool parseFilter(const QString &str, Filter *filter);
+	static bool parseCompressionLevel(const QString &str, int *level);
+
+	// Image size of PNG or RAW file, invalid if file is not readable
+	static QSize imageSize(const QString &filePath);
+
+	QString fileSuffix() const;
+
+	// Identifies encoded output for the image cache
+	QByteArray key() const;
+
+	bool encode(const QImage &image, QByteArray *output) const;
+
+private:
+	bool usesQt() const;
+	bool encodePng(const QImage &image, QByteArray *output) const;
+	bool encodeRaw(const QImage &image, QByteArray *output) const;
+
+	Format mFormat;
+	Strategy mStrategy;
+	Filter mFilter;
+	int mCompressionLevel;
+};
+
+ImageEncoder::Format ImageEncoder::format() const
+{
+	return mFormat;
+}
+
+int ImageEncoder::compressionLevel() const
+{
+	return mCompressionLevel;
+}
+
+ImageEncoder::Strategy ImageEncoder::strategy() const
+{
+	return mStrategy;
+}
+
+ImageEncoder::Filter ImageEncoder::filter() const
+{
+	return mFilter;
+}
+
+void ImageEncoder::setFormat(Format format)
+{
+	mFormat = format;
+}
+
+void ImageEncoder::setCompressionLevel(int level)
+{
+	mCompressionLevel = level;
+}
+
+void ImageEncoder::setStrategy(Strategy strategy)
+{
+	mStrategy = strategy;
+}
+
+void ImageEncoder::setFilter(Filter filter)
+{
+	mFilter = filter;
+}
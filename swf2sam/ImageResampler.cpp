@@ -0,0 +1,561 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ImageResampler.h"
+
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// SSE2 is always available on x86-64, 32-bit builds use scalar kernels
+#if defined(__x86_64__) || defined(_M_X64)
+#define IMAGE_RESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+enum
+{
+	// Weights are signed 16-bit fixed point numbers,
+	// 255 * sum of weights must fit to 32-bit
+	PRECISION_BITS = 14,
+	PRECISION_HALF = 1 << (PRECISION_BITS - 1),
+
+	// Smaller images are not split between threads
+	MIN_PARALLEL_PIXELS = 256 * 256,
+	MIN_BAND_ROWS = 32
+};
+
+// Resampling a separate thread pool lets image export jobs
+// wait for bands without blocking their own pool
+Q_GLOBAL_STATIC(QThreadPool, resamplerThreadPool)
+
+// Source range and weights of every output pixel along one axis
+struct ResampleWeights
+{
+	std::vector<int> starts;
+	std::vector<int> counts;
+	std::vector<qint16> weights;
+	int kernelSize;
+
+	inline const qint16 *at(int index) const;
+};
+
+const qint16 *ResampleWeights::at(int index) const
+{
+	return &weights[size_t(index) * size_t(kernelSize)];
+}
+
+struct FilterName
+{
+	const char *name;
+	ImageResampler::Filter value;
+};
+
+static const FilterName FILTER_NAMES[] = {
+	{"qt", ImageResampler::FILTER_QT},
+	{"box", ImageResampler::FILTER_BOX},
+	{"bilinear", ImageResampler::FILTER_BILINEAR},
+	{"lanczos", ImageResampler::FILTER_LANCZOS},
+};
+
+static double boxKernel(double x)
+{
+	return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+static double bilinearKernel(double x)
+{
+	x = std::fabs(x);
+
+	return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+static double sinc(double x)
+{
+	if (x == 0.0)
+		return 1.0;
+
+	x *= M_PI;
+	return std::sin(x) / x;
+}
+
+static double lanczosKernel(double x)
+{
+	if (x <= -3.0 || x >= 3.0)
+		return 0.0;
+
+	return sinc(x) * sinc(x / 3.0);
+}
+
+static ResampleWeights computeWeights(
+	int inSize, int outSize, ImageResampler::Filter filter)
+{
+	double support;
+	double (*kernel)(double);
+
+	switch (filter)
+	{
+		case ImageResampler::FILTER_BOX:
+			support = 0.5;
+			kernel = boxKernel;
+			break;
+
+		case ImageResampler::FILTER_BILINEAR:
+			support = 1.0;
+			kernel = bilinearKernel;
+			break;
+
+		default:
+			support = 3.0;
+			kernel = lanczosKernel;
+			break;
+	}
+
+	// Downscale widens the kernel, so every source pixel contributes
+	double scale = double(inSize) / outSize;
+	double filterScale = qMax(scale, 1.0);
+	support *= filterScale;
+
+	ResampleWeights result;
+	result.kernelSize = int(std::ceil(support)) * 2 + 1;
+	result.starts.resize(size_t(outSize));
+	result.counts.resize(size_t(outSize));
+	result.weights.assign(size_t(outSize) * size_t(result.kernelSize), 0);
+
+	std::vector<double> values(size_t(result.kernelSize));
+
+	for (int i = 0; i < outSize; i++)
+	{
+		double center = (i + 0.5) * scale;
+		int first = qMax(int(center - support + 0.5), 0);
+		int last = qMin(int(center + support + 0.5), inSize);
+		int count = qMin(last - first, result.kernelSize);
+
+		double total = 0.0;
+
+		for (int k = 0; k < count; k++)
+		{
+			double value = kernel((k + first - center + 0.5) / filterScale);
+			values[size_t(k)] = value;
+			total += value;
+		}
+
+		auto weights = &result.weights[size_t(i) * size_t(result.kernelSize)];
+
+		for (int k = 0; k < count; k++)
+		{
+			double value = total != 0.0 ? values[size_t(k)] / total : 0.0;
+			weights[k] = qint16(qRound(value * (1 << PRECISION_BITS)));
+		}
+
+		result.starts[size_t(i)] = first;
+		result.counts[size_t(i)] = count;
+	}
+
+	return result;
+}
+
+static inline quint8 clampToByte(int value)
+{
+	value >>= PRECISION_BITS;
+
+	if (value < 0)
+		return 0;
+
+	if (value > 255)
+		return 255;
+
+	return quint8(value);
+}
+
+static void resampleRowScalar(
+	const quint8 *src, quint8 *dst, const ResampleWeights &weights, int width)
+{
+	for (int x = 0; x < width; x++)
+	{
+		auto p = src + weights.starts[size_t(x)] * 4;
+		auto w = weights.at(x);
+		int count = weights.counts[size_t(x)];
+
+		int r = PRECISION_HALF;
+		int g = PRECISION_HALF;
+		int b = PRECISION_HALF;
+		int a = PRECISION_HALF;
+
+		for (int k = 0; k < count; k++)
+		{
+			r += p[0] * w[k];
+			g += p[1] * w[k];
+			b += p[2] * w[k];
+			a += p[3] * w[k];
+			p += 4;
+		}
+
+		*dst++ = clampToByte(r);
+		*dst++ = clampToByte(g);
+		*dst++ = clampToByte(b);
+		*dst++ = clampToByte(a);
+	}
+}
+
+static void resampleColumnScalar(const quint8 *src, int stride,
+	const qint16 *w, int count, quint8 *dst, int byteCount)
+{
+	for (int i = 0; i < byteCount; i++)
+	{
+		int sum = PRECISION_HALF;
+		auto p = src + i;
+
+		for (int k = 0; k < count; k++)
+		{
+			sum += *p * w[k];
+			p += stride;
+		}
+
+		dst[i] = clampToByte(sum);
+	}
+}
+
+// Negative lobes of Lanczos filter may produce
+// color values larger than alpha
+static void clampPremultipliedScalar(quint8 *rgba, int pixelCount)
+{
+	for (int i = 0; i < pixelCount; i++)
+	{
+		quint8 a = rgba[3];
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (rgba[c] > a)
+				rgba[c] = a;
+		}
+
+		rgba += 4;
+	}
+}
+
+#ifdef IMAGE_RESAMPLER_SSE2
+static inline __m128i weightPair(qint16 w0, qint16 w1)
+{
+	return _mm_set1_epi32(
+		int(quint32(quint16(w0)) | (quint32(quint16(w1)) << 16)));
+}
+
+static void resampleRowSSE2(
+	const quint8 *src, quint8 *dst, const ResampleWeights &weights, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for (int x = 0; x < width; x++)
+	{
+		auto p = src + weights.starts[size_t(x)] * 4;
+		auto w = weights.at(x);
+		int count = weights.counts[size_t(x)];
+
+		__m128i sum = _mm_set1_epi32(PRECISION_HALF);
+
+		int k = 0;
+
+		for (; k + 2 <= count; k += 2)
+		{
+			// r0 g0 b0 a0 r1 g1 b1 a1 is shuffled to r0 r1 g0 g1 b0 b1 a0 a1
+			// to multiply and add pixel pairs at once
+			__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+			v = _mm_unpacklo_epi8(v, zero);
+			v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+			sum = _mm_add_epi32(
+				sum, _mm_madd_epi16(v, weightPair(w[k], w[k + 1])));
+			p += 8;
+		}
+
+		if (k < count)
+		{
+			int pixel;
+			memcpy(&pixel, p, sizeof(pixel));
+			__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+			v = _mm_unpacklo_epi16(v, zero);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(v, weightPair(w[k], 0)));
+		}
+
+		sum = _mm_srai_epi32(sum, PRECISION_BITS);
+		sum = _mm_packs_epi32(sum, sum);
+		sum = _mm_packus_epi16(sum, sum);
+
+		int pixel = _mm_cvtsi128_si32(sum);
+		memcpy(dst, &pixel, sizeof(pixel));
+		dst += 4;
+	}
+}
+
+static void resampleColumnSSE2(const quint8 *src, int stride,
+	const qint16 *w, int count, quint8 *dst, int byteCount)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	int i = 0;
+
+	for (; i + 16 <= byteCount; i += 16)
+	{
+		__m128i sum[4];
+
+		for (auto &s : sum)
+			s = _mm_set1_epi32(PRECISION_HALF);
+
+		auto p = src + i;
+
+		for (int k = 0; k < count; k += 2)
+		{
+			// Bytes of two rows are interleaved to multiply and add at once
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			__m128i b = zero;
+			__m128i wk;
+
+			if (k + 1 < count)
+			{
+				b = _mm_loadu_si128(
+					reinterpret_cast<const __m128i *>(p + stride));
+				wk = weightPair(w[k], w[k + 1]);
+			} else
+			{
+				wk = weightPair(w[k], 0);
+			}
+
+			__m128i alo = _mm_unpacklo_epi8(a, zero);
+			__m128i ahi = _mm_unpackhi_epi8(a, zero);
+			__m128i blo = _mm_unpacklo_epi8(b, zero);
+			__m128i bhi = _mm_unpackhi_epi8(b, zero);
+
+			sum[0] = _mm_add_epi32(
+				sum[0], _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), wk));
+			sum[1] = _mm_add_epi32(
+				sum[1], _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), wk));
+			sum[2] = _mm_add_epi32(
+				sum[2], _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), wk));
+			sum[3] = _mm_add_epi32(
+				sum[3], _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), wk));
+
+			p += stride * 2;
+		}
+
+		for (auto &s : sum)
+			s = _mm_srai_epi32(s, PRECISION_BITS);
+
+		__m128i v = _mm_packus_epi16(
+			_mm_packs_epi32(sum[0], sum[1]), _mm_packs_epi32(sum[2], sum[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+	}
+
+	resampleColumnScalar(src + i, stride, w, count, dst + i, byteCount - i);
+}
+
+static void clampPremultipliedSSE2(quint8 *rgba, int pixelCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		auto p = reinterpret_cast<__m128i *>(rgba);
+		__m128i v = _mm_loadu_si128(p);
+
+		// Broadcast alpha to all bytes of the pixel
+		__m128i a = _mm_srli_epi32(v, 24);
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+		_mm_storeu_si128(p, _mm_min_epu8(v, a));
+		rgba += 16;
+	}
+
+	clampPremultipliedScalar(rgba, pixelCount - i);
+}
+#endif
+
+static void forEachBand(int rowCount, qint64 pixelCount,
+	const std::function<void(int, int)> &func)
+{
+	int bandCount = 1;
+
+	if (pixelCount >= MIN_PARALLEL_PIXELS)
+	{
+		bandCount = qBound(1, rowCount / MIN_BAND_ROWS,
+			resamplerThreadPool()->maxThreadCount());
+	}
+
+	std::vector<QFuture<void>> jobs;
+
+	for (int band = 1; band < bandCount; band++)
+	{
+		int begin = int(qint64(rowCount) * band / bandCount);
+		int end = int(qint64(rowCount) * (band + 1) / bandCount);
+
+		jobs.push_back(QtConcurrent::run(resamplerThreadPool(),
+			[&func, begin, end]() { func(begin, end); }));
+	}
+
+	// The first band is resampled by the calling thread
+	func(0, int(qint64(rowCount) / bandCount));
+
+	for (auto &job : jobs)
+		job.waitForFinished();
+}
+
+ImageResampler::ImageResampler()
+	: mFilter(FILTER_QT)
+{
+}
+
+bool ImageResampler::parseFilter(const QString &str, Filter *filter)
+{
+	Q_ASSERT(nullptr != filter);
+
+	for (auto &f : FILTER_NAMES)
+	{
+		if (0 == str.compare(QLatin1String(f.name), Qt::CaseInsensitive))
+		{
+			*filter = f.value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char *ImageResampler::filterName(Filter filter)
+{
+	for (auto &f : FILTER_NAMES)
+	{
+		if (f.value == filter)
+			return f.name;
+	}
+
+	return "";
+}
+
+QImage ImageResampler::scaled(const QImage &image, int width, int height) const
+{
+	if (mFilter == FILTER_QT)
+	{
+		return image.scaled(
+			width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+
+	return resample(image, width, height, true);
+}
+
+QImage ImageResampler::scaledScalar(
+	const QImage &image, int width, int height) const
+{
+	if (mFilter == FILTER_QT)
+		return scaled(image, width, height);
+
+	return resample(image, width, height, false);
+}
+
+QImage ImageResampler::resample(
+	const QImage &image, int width, int height, bool vectorized) const
+{
+	if (image.isNull() || width <= 0 || height <= 0)
+		return QImage();
+
+	auto format = QImage::Format_RGBA8888_Premultiplied;
+	QImage src =
+		image.format() == format ? image : image.convertToFormat(format);
+
+	int srcWidth = src.width();
+	int srcHeight = src.height();
+
+	if (srcWidth == width && srcHeight == height)
+		return src;
+
+	auto resampleRow = resampleRowScalar;
+	auto resampleColumn = resampleColumnScalar;
+	auto clampPremultiplied = clampPremultipliedScalar;
+
+#ifdef IMAGE_RESAMPLER_SSE2
+	if (vectorized)
+	{
+		resampleRow = resampleRowSSE2;
+		resampleColumn = resampleColumnSSE2;
+		clampPremultiplied = clampPremultipliedSSE2;
+	}
+#else
+	Q_UNUSED(vectorized);
+#endif
+
+	QImage dst(width, height, format);
+
+	if (dst.isNull())
+		return QImage();
+
+	// Pointers are taken before threads start, so the image is not detached
+	const quint8 *srcBits = src.constBits();
+	int srcStride = src.bytesPerLine();
+	quint8 *dstBits = dst.bits();
+	int dstStride = dst.bytesPerLine();
+
+	// Horizontal pass goes first, its rows are the vertical pass input
+	const quint8 *columnBits = srcBits;
+	int columnStride = srcStride;
+	std::vector<quint8> rows;
+
+	if (srcWidth != width)
+	{
+		auto weights = computeWeights(srcWidth, width, mFilter);
+
+		quint8 *rowBits = dstBits;
+		int rowStride = dstStride;
+
+		if (srcHeight != height)
+		{
+			rowStride = width * 4;
+			rows.resize(size_t(rowStride) * size_t(srcHeight));
+			rowBits = rows.data();
+			columnBits = rowBits;
+			columnStride = rowStride;
+		}
+
+		forEachBand(srcHeight, qint64(width) * srcHeight,
+			[&](int begin, int end) {
+				for (int y = begin; y < end; y++)
+				{
+					resampleRow(srcBits + qint64(y) * srcStride,
+						rowBits + qint64(y) * rowStride, weights, width);
+				}
+			});
+	}
+
+	if (srcHeight != height)
+	{
+		auto weights = computeWeights(srcHeight, height, mFilter);
+
+		forEachBand(height, qint64(width) * height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				resampleColumn(columnBits +
+						qint64(weights.starts[size_t(y)]) * columnStride,
+					columnStride, weights.at(y), weights.counts[size_t(y)],
+					dstBits + qint64(y) * dstStride, width * 4);
+			}
+		});
+	}
+
+	if (mFilter == FILTER_LANCZOS)
+	{
+		forEachBand(height, qint64(width) * height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				clampPremultiplied(dstBits + qint64(y) * dstStride, width);
+			}
+		});
+	}
+
+	return dst;
+}
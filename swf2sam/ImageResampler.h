@@ -0,0 +1,56 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+// Separable resampler for premultiplied RGBA images.
+// Filter weights are computed once per output row and column,
+// SSE2 kernels are used on x86 and rows of large images are split
+// between threads. FILTER_QT leaves scaling to QImage.
+class ImageResampler
+{
+public:
+	enum Filter
+	{
+		FILTER_QT,
+		FILTER_BOX,
+		FILTER_BILINEAR,
+		FILTER_LANCZOS
+	};
+
+	ImageResampler();
+
+	static bool parseFilter(const QString &str, Filter *filter);
+	static const char *filterName(Filter filter);
+
+	inline Filter filter() const;
+	inline void setFilter(Filter filter);
+
+	// Result format is QImage::Format_RGBA8888_Premultiplied
+	// for all filters except FILTER_QT
+	QImage scaled(const QImage &image, int width, int height) const;
+
+	// Reference implementation without vector instructions
+	QImage scaledScalar(const QImage &image, int width, int height) const;
+
+private:
+	QImage resample(
+		const QImage &image, int width, int height, bool vectorized) const;
+
+	Filter mFilter;
+};
+
+ImageResampler::Filter ImageResampler::filter() const
+{
+	return mFilter;
+}
+
+void ImageResampler::setFilter(Filter filter)
+{
+	mFilter = filter;
+}
@@ -0,0 +1,285 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "JpegDecoder.h"
+
+#include "SegmentedDevice.h"
+
+#ifdef SWF2SAM_LIBJPEG
+#include <QtEndian>
+#include <QtMath>
+
+#include <csetjmp>
+#include <cstdio>
+
+#include <jpeglib.h>
+
+#ifndef JCS_EXTENSIONS
+#error "libjpeg-turbo is required for SWF2SAM_LIBJPEG"
+#endif
+
+enum
+{
+	MAX_SCALE_DENOM = 8,
+	JPEG_SOI = 0xD8
+};
+
+struct JpegErrorManager
+{
+	jpeg_error_mgr pub;
+	jmp_buf jump;
+};
+
+// Feeds segments to the decoder one by one without copying
+struct JpegSegmentSource
+{
+	jpeg_source_mgr pub;
+	const SegmentedDevice::Segments *segments;
+	size_t nextSegment;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo)
+{
+	longjmp(reinterpret_cast<JpegErrorManager *>(cinfo->err)->jump, 1);
+}
+
+static void jpegOutputMessage(j_common_ptr)
+{
+	// Corrupt data warnings are not printed
+}
+
+static void jpegInitSource(j_decompress_ptr)
+{
+}
+
+static boolean jpegFillInputBuffer(j_decompress_ptr cinfo)
+{
+	auto src = reinterpret_cast<JpegSegmentSource *>(cinfo->src);
+	auto &segments = *src->segments;
+
+	if (src->nextSegment < segments.size())
+	{
+		auto &segment = segments.at(src->nextSegment++);
+		src->pub.next_input_byte =
+			reinterpret_cast<const JOCTET *>(segment.data);
+		src->pub.bytes_in_buffer = size_t(segment.size);
+		return TRUE;
+	}
+
+	// Truncated data is finished with EOI marker like in libjpeg sources
+	static const JOCTET eoi[] = {0xFF, JPEG_EOI};
+	src->pub.next_input_byte = eoi;
+	src->pub.bytes_in_buffer = sizeof(eoi);
+	return TRUE;
+}
+
+static void jpegSkipInputData(j_decompress_ptr cinfo, long byteCount)
+{
+	auto src = reinterpret_cast<JpegSegmentSource *>(cinfo->src);
+
+	while (byteCount > 0)
+	{
+		if (size_t(byteCount) <= src->pub.bytes_in_buffer)
+		{
+			src->pub.next_input_byte += byteCount;
+			src->pub.bytes_in_buffer -= size_t(byteCount);
+			return;
+		}
+
+		byteCount -= long(src->pub.bytes_in_buffer);
+		src->pub.bytes_in_buffer = 0;
+
+		bool finished = src->nextSegment >= src->segments->size();
+		jpegFillInputBuffer(cinfo);
+
+		// Inserted EOI marker is not skipped
+		if (finished)
+			return;
+	}
+}
+
+static void jpegTermSource(j_decompress_ptr)
+{
+}
+
+static bool outputColorSpace(QImage::Format format, J_COLOR_SPACE *space)
+{
+	switch (format)
+	{
+		case QImage::Format_RGBX8888:
+			*space = JCS_EXT_RGBX;
+			return true;
+
+		case QImage::Format_RGB32:
+		case QImage::Format_ARGB32:
+			// 0xAARRGGBB words in memory
+			*space = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? JCS_EXT_BGRA
+													  : JCS_EXT_ARGB;
+			return true;
+
+		case QImage::Format_RGB888:
+			*space = JCS_EXT_RGB;
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+// Largest reduction keeping the image not smaller than the target size
+static unsigned scaleDenom(int width, int height, qreal minScale)
+{
+	if (minScale >= 1.0)
+		return 1;
+
+	int targetWidth = qCeil(width * minScale);
+	int targetHeight = qCeil(height * minScale);
+
+	unsigned denom = 1;
+
+	while (denom < MAX_SCALE_DENOM)
+	{
+		int next = int(denom * 2);
+
+		if ((width + next - 1) / next < targetWidth ||
+			(height + next - 1) / next < targetHeight)
+		{
+			break;
+		}
+
+		denom = unsigned(next);
+	}
+
+	return denom;
+}
+#endif
+
+bool JpegDecoder::isAvailable()
+{
+#ifdef SWF2SAM_LIBJPEG
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool JpegDecoder::decode(const SegmentedDevice &device, qreal minScale,
+	QImage::Format format, QImage *image, QSize *originalSize)
+{
+	Q_ASSERT(nullptr != image);
+	Q_ASSERT(nullptr != originalSize);
+
+#ifdef SWF2SAM_LIBJPEG
+	auto &segments = device.segments();
+
+	if (segments.empty() || segments.front().size < 2 ||
+		quint8(segments.front().data[0]) != 0xFF ||
+		quint8(segments.front().data[1]) != JPEG_SOI)
+	{
+		return false;
+	}
+
+	J_COLOR_SPACE outputSpace;
+
+	if (not outputColorSpace(format, &outputSpace))
+		return false;
+
+	// Objects with destructors are not touched between setjmp and
+	// longjmp, so the image is allocated between two guarded scopes
+	jpeg_decompress_struct cinfo;
+	JpegErrorManager error;
+	JpegSegmentSource source;
+
+	cinfo.err = jpeg_std_error(&error.pub);
+	error.pub.error_exit = jpegErrorExit;
+	error.pub.output_message = jpegOutputMessage;
+
+	if (setjmp(error.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_create_decompress(&cinfo);
+
+	source.pub.init_source = jpegInitSource;
+	source.pub.fill_input_buffer = jpegFillInputBuffer;
+	source.pub.skip_input_data = jpegSkipInputData;
+	source.pub.resync_to_restart = jpeg_resync_to_restart;
+	source.pub.term_source = jpegTermSource;
+	source.pub.next_input_byte = nullptr;
+	source.pub.bytes_in_buffer = 0;
+	source.segments = &segments;
+	source.nextSegment = 0;
+	cinfo.src = &source.pub;
+
+	jpeg_read_header(&cinfo, TRUE);
+
+	switch (cinfo.jpeg_color_space)
+	{
+		case JCS_GRAYSCALE:
+		case JCS_YCbCr:
+		case JCS_RGB:
+			break;
+
+		default:
+			// CMYK and YCCK are left to Qt
+			jpeg_destroy_decompress(&cinfo);
+			return false;
+	}
+
+	int width = int(cinfo.image_width);
+	int height = int(cinfo.image_height);
+
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = scaleDenom(width, height, minScale);
+	cinfo.out_color_space = outputSpace;
+
+	// Output size is known without starting decompression
+	jpeg_calc_output_dimensions(&cinfo);
+
+	QImage result(
+		int(cinfo.output_width), int(cinfo.output_height), format);
+
+	if (result.isNull())
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	// Only plain pointers to the image memory are used in the second
+	// guarded scope, the image is released outside of it
+	uchar *bits = result.bits();
+	auto bytesPerLine = size_t(result.bytesPerLine());
+
+	if (setjmp(error.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_start_decompress(&cinfo);
+
+	while (cinfo.output_scanline < cinfo.output_height)
+	{
+		JSAMPROW row = bits + cinfo.output_scanline * bytesPerLine;
+		jpeg_read_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	*image = result;
+	*originalSize = QSize(width, height);
+	return true;
+#else
+	Q_UNUSED(device);
+	Q_UNUSED(minScale);
+	Q_UNUSED(format);
+	return false;
+#endif
+}
@@ -0,0 +1,27 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QImage>
+#include <QSize>
+
+class SegmentedDevice;
+
+// Decodes JPEG segments with libjpeg-turbo if built with SWF2SAM_LIBJPEG.
+// Downscale by 1/2, 1/4 or 1/8 is done by scaled IDCT and pixels are
+// written straight in the requested format. Decoding fails without
+// libjpeg, for other image types or color spaces, so the caller
+// can fall back to Qt image readers.
+class JpegDecoder
+{
+public:
+	static bool isAvailable();
+
+	// Image is decoded at least minScale times its original size.
+	// Supported formats are RGBX8888, RGB32, ARGB32 and RGB888.
+	static bool decode(const SegmentedDevice &device, qreal minScale,
+		QImage::Format format, QImage *image, QSize *originalSize);
+};
@@ -0,0 +1,214 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "MappedSWFReader.h"
+
+#include "rfxswf.h"
+
+#include <cstdlib>
+
+enum
+{
+	SWF_HEADER_SIZE = 8,
+	TAG_SHORT_LEN_MASK = 0x3F
+};
+
+MappedSWFReader::MappedSWFReader()
+	: mData(nullptr)
+	, mSize(0)
+{
+}
+
+MappedSWFReader::~MappedSWFReader()
+{
+	if (nullptr != mData && mFile.isOpen())
+		mFile.unmap(const_cast<uchar *>(mData));
+}
+
+bool MappedSWFReader::open(const QString &filePath)
+{
+	Q_ASSERT(nullptr == mData);
+
+	mFile.setFileName(filePath);
+
+	if (not mFile.open(QFile::ReadOnly))
+		return false;
+
+	mSize = mFile.size();
+
+	if (mSize < SWF_HEADER_SIZE)
+		return false;
+
+	// Private mapping is copy-on-write, so tag data can be patched
+	// in place as with tags read by swf_ReadSWF2
+	mData = mFile.map(0, mSize, QFileDevice::MapPrivateOption);
+
+	if (nullptr == mData)
+		return false;
+
+	return checkHeader();
+}
+
+bool MappedSWFReader::open(const QByteArray &data)
+{
+	Q_ASSERT(nullptr == mData);
+
+	if (data.size() < SWF_HEADER_SIZE)
+		return false;
+
+	mBytes = data;
+	mSize = mBytes.size();
+	mData = reinterpret_cast<const uchar *>(mBytes.constData());
+
+	return checkHeader();
+}
+
+bool MappedSWFReader::checkHeader() const
+{
+	// Compressed files have to be inflated anyway.
+	// Files not matching their header are left to swf_ReadSWF2,
+	// so they are read the same way as without the mapping.
+	return mData[0] == 'F' && mData[1] == 'W' && mData[2] == 'S' &&
+		mData[3] != 0 && qint64(GET32(&mData[4])) == mSize;
+}
+
+bool MappedSWFReader::read(SWF *swf)
+{
+	Q_ASSERT(nullptr != swf);
+	Q_ASSERT(nullptr != mData);
+
+	memset(swf, 0, sizeof(SWF));
+
+	swf->fileVersion = mData[3];
+	swf->fileSize = GET32(&mData[4]);
+
+	qint64 pos = SWF_HEADER_SIZE;
+
+	int rectSize = parseRect(&mData[pos], mSize - pos, &swf->movieSize);
+
+	if (rectSize < 0)
+		return false;
+
+	pos += rectSize;
+
+	if (pos + 4 > mSize)
+		return false;
+
+	swf->frameRate = GET16(&mData[pos]);
+	swf->frameCount = GET16(&mData[pos + 2]);
+	pos += 4;
+
+	TAG *prev = nullptr;
+
+	while (pos + 2 <= mSize)
+	{
+		U16 header = GET16(&mData[pos]);
+		pos += 2;
+
+		U32 len = header & TAG_SHORT_LEN_MASK;
+
+		if (len == TAG_SHORT_LEN_MASK)
+		{
+			if (pos + 4 > mSize)
+				break;
+
+			len = GET32(&mData[pos]);
+			pos += 4;
+		}
+
+		// Truncated tags are dropped the same way swf_ReadSWF2 does
+		if (qint64(len) > mSize - pos)
+			break;
+
+		auto tag = reinterpret_cast<TAG *>(calloc(1, sizeof(TAG)));
+
+		if (nullptr == tag)
+		{
+			freeTags(swf);
+			return false;
+		}
+
+		tag->id = header >> 6;
+		tag->len = len;
+		tag->memsize = len;
+		tag->data = len > 0 ? const_cast<U8 *>(&mData[pos]) : nullptr;
+		tag->prev = prev;
+
+		if (nullptr != prev)
+		{
+			prev->next = tag;
+		} else
+		{
+			swf->firstTag = tag;
+		}
+
+		if (tag->id == ST_FILEATTRIBUTES && len >= 4)
+		{
+			swf->fileAttributes = GET32(tag->data);
+		}
+
+		pos += len;
+		prev = tag;
+	}
+
+	return true;
+}
+
+void MappedSWFReader::freeTags(SWF *swf)
+{
+	Q_ASSERT(nullptr != swf);
+
+	auto tag = swf->firstTag;
+
+	while (nullptr != tag)
+	{
+		auto next = tag->next;
+		free(tag);
+		tag = next;
+	}
+
+	swf->firstTag = nullptr;
+}
+
+int MappedSWFReader::parseRect(const uchar *data, qint64 size, SRECT *rect)
+{
+	Q_ASSERT(nullptr != rect);
+
+	if (size < 1)
+		return -1;
+
+	int bitCount = data[0] >> 3;
+	int byteCount = (5 + bitCount * 4 + 7) / 8;
+
+	if (byteCount > size)
+		return -1;
+
+	int bitPos = 5;
+
+	auto readBits = [data, bitCount, &bitPos]() -> S32 {
+		U32 value = 0;
+
+		for (int i = 0; i < bitCount; i++, bitPos++)
+		{
+			value <<= 1;
+			value |= (data[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+		}
+
+		if (bitCount > 0 && 0 != (value & (1U << (bitCount - 1))))
+		{
+			value |= ~0U << bitCount;
+		}
+
+		return S32(value);
+	};
+
+	rect->xmin = readBits();
+	rect->xmax = readBits();
+	rect->ymin = readBits();
+	rect->ymax = readBits();
+
+	return byteCount;
+}
@@ -0,0 +1,51 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+extern "C"
+{
+struct _SWF;
+struct _SRECT;
+}
+
+// Reads uncompressed (FWS) SWF-files through a memory mapping
+// or directly from SWF data already in memory.
+// Tag payloads point straight into the mapping instead of being
+// copied into separately allocated buffers, so tags read by this
+// reader must be released with freeTags() instead of swf_FreeTags().
+// A file is mapped copy-on-write, but tags read from data in memory
+// share it with the caller and must not be modified.
+class MappedSWFReader
+{
+public:
+	MappedSWFReader();
+	~MappedSWFReader();
+
+	// Returns false if the file cannot be mapped, is compressed
+	// or its size does not match the SWF header
+	bool open(const QString &filePath);
+	// Keeps a shallow copy of data, so it is not copied
+	bool open(const QByteArray &data);
+	bool read(struct _SWF *swf);
+
+	static void freeTags(struct _SWF *swf);
+
+	// Returns the number of bytes occupied by the rectangle
+	// or -1 if there is not enough data
+	static int parseRect(const uchar *data, qint64 size, struct _SRECT *rect);
+
+private:
+	bool checkHeader() const;
+
+	QFile mFile;
+	QByteArray mBytes;
+	const uchar *mData;
+	qint64 mSize;
+};
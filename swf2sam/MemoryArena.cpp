@@ -0,0 +1,160 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "MemoryArena.h"
+
+#include <cstddef>
+#include <new>
+
+enum : size_t
+{
+	MIN_BLOCK_SIZE = 64 * 1024,
+	MAX_BLOCK_SIZE = 16 * 1024 * 1024
+};
+
+static const size_t BLOCK_HEADER_SIZE =
+	(sizeof(void *) * 2 + alignof(std::max_align_t) - 1) &
+	~(alignof(std::max_align_t) - 1);
+
+static thread_local std::unique_ptr<MemoryArena> threadArena;
+static thread_local bool threadArenaBusy = false;
+
+static inline char *alignUp(char *ptr, size_t alignment)
+{
+	auto value = reinterpret_cast<quintptr>(ptr);
+	value = (value + alignment - 1) & ~quintptr(alignment - 1);
+	return reinterpret_cast<char *>(value);
+}
+
+MemoryArena::MemoryArena()
+	: mBlocks(nullptr)
+	, mCurrent(nullptr)
+	, mEnd(nullptr)
+	, mNextBlockSize(MIN_BLOCK_SIZE)
+	, mBytesUsed(0)
+	, mBytesReserved(0)
+{
+	static_assert(sizeof(Block) <= sizeof(void *) * 2, "Bad block header");
+}
+
+MemoryArena::~MemoryArena()
+{
+	while (nullptr != mBlocks)
+	{
+		auto next = mBlocks->next;
+		::operator delete(mBlocks);
+		mBlocks = next;
+	}
+}
+
+void *MemoryArena::allocate(size_t size, size_t alignment)
+{
+	Q_ASSERT(alignment > 0 && 0 == (alignment & (alignment - 1)));
+
+	if (0 == size)
+		size = 1;
+
+	mBytesUsed += size;
+
+	char *result = alignUp(mCurrent, alignment);
+
+	if (nullptr != mCurrent && result <= mEnd &&
+		size <= size_t(mEnd - result))
+	{
+		mCurrent = result + size;
+		return result;
+	}
+
+	if (size > mNextBlockSize / 4)
+	{
+		// Large allocations get their own block,
+		// so the rest of the current one is not wasted
+		return alignUp(allocateBlock(size + alignment), alignment);
+	}
+
+	char *data = allocateBlock(mNextBlockSize);
+	mCurrent = data;
+	mEnd = data + mNextBlockSize;
+
+	if (mNextBlockSize < MAX_BLOCK_SIZE)
+		mNextBlockSize *= 2;
+
+	result = alignUp(mCurrent, alignment);
+	mCurrent = result + size;
+	return result;
+}
+
+void MemoryArena::reset()
+{
+	Block *largest = nullptr;
+
+	for (auto block = mBlocks; nullptr != block; block = block->next)
+	{
+		if (nullptr == largest || block->size > largest->size)
+			largest = block;
+	}
+
+	while (nullptr != mBlocks)
+	{
+		auto next = mBlocks->next;
+
+		if (mBlocks != largest)
+			::operator delete(mBlocks);
+
+		mBlocks = next;
+	}
+
+	mBytesUsed = 0;
+	mBytesReserved = 0;
+	mCurrent = nullptr;
+	mEnd = nullptr;
+
+	if (nullptr != largest)
+	{
+		largest->next = nullptr;
+		mBlocks = largest;
+		mBytesReserved = largest->size;
+		mCurrent = reinterpret_cast<char *>(largest) + BLOCK_HEADER_SIZE;
+		mEnd = mCurrent + largest->size;
+	}
+}
+
+char *MemoryArena::allocateBlock(size_t size)
+{
+	auto block = static_cast<Block *>(
+		::operator new(BLOCK_HEADER_SIZE + size));
+	block->next = mBlocks;
+	block->size = size;
+	mBlocks = block;
+	mBytesReserved += size;
+
+	return reinterpret_cast<char *>(block) + BLOCK_HEADER_SIZE;
+}
+
+MemoryArenaLease::MemoryArenaLease()
+	: mArena(nullptr)
+{
+	if (threadArenaBusy)
+	{
+		mPrivateArena.reset(new MemoryArena);
+		mArena = mPrivateArena.get();
+		return;
+	}
+
+	if (nullptr == threadArena)
+		threadArena.reset(new MemoryArena);
+
+	threadArenaBusy = true;
+	mArena = threadArena.get();
+}
+
+MemoryArenaLease::~MemoryArenaLease()
+{
+	if (nullptr != mPrivateArena)
+		return;
+
+	mArena->reset();
+	threadArenaBusy = false;
+}
@@ -0,0 +1,158 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Monotonic memory arena. Allocations are cut from large blocks and
+// are never freed one by one, all memory is released by reset().
+// The largest block is kept, so the next user of the arena usually
+// does not allocate from the heap at all.
+class MemoryArena
+{
+public:
+	MemoryArena();
+	~MemoryArena();
+
+	MemoryArena(const MemoryArena &) = delete;
+	MemoryArena &operator=(const MemoryArena &) = delete;
+
+	void *allocate(size_t size, size_t alignment);
+	void reset();
+
+	inline size_t bytesUsed() const;
+	inline size_t bytesReserved() const;
+
+private:
+	struct Block
+	{
+		Block *next;
+		size_t size;
+	};
+
+	char *allocateBlock(size_t size);
+
+	Block *mBlocks;
+	char *mCurrent;
+	char *mEnd;
+	size_t mNextBlockSize;
+	size_t mBytesUsed;
+	size_t mBytesReserved;
+};
+
+// Standard allocator taking memory from MemoryArena.
+// Deallocation does nothing, memory is returned by arena reset.
+// Conversion from an arena pointer is implicit like in std::pmr.
+template <typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator(MemoryArena *arena);
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other);
+
+	T *allocate(size_t count);
+	void deallocate(T *, size_t);
+
+	inline MemoryArena *arena() const;
+
+private:
+	MemoryArena *mArena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return a.arena() != b.arena();
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename K, typename V>
+using ArenaMap =
+	std::map<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+// Borrows the arena of the current thread for one conversion.
+// Conversions running one after another in a thread, like batch mode
+// workers, reuse the same arena blocks. A nested user gets a private
+// arena. The arena is reset when the lease is destroyed.
+class MemoryArenaLease
+{
+public:
+	MemoryArenaLease();
+	~MemoryArenaLease();
+
+	MemoryArenaLease(const MemoryArenaLease &) = delete;
+	MemoryArenaLease &operator=(const MemoryArenaLease &) = delete;
+
+	inline MemoryArena *arena() const;
+
+private:
+	std::unique_ptr<MemoryArena> mPrivateArena;
+	MemoryArena *mArena;
+};
+
+size_t MemoryArena::bytesUsed() const
+{
+	return mBytesUsed;
+}
+
+size_t MemoryArena::bytesReserved() const
+{
+	return mBytesReserved;
+}
+
+template <typename T>
+ArenaAllocator<T>::ArenaAllocator(MemoryArena *arena)
+	: mArena(arena)
+{
+	Q_ASSERT(nullptr != arena);
+}
+
+template <typename T>
+template <typename U>
+ArenaAllocator<T>::ArenaAllocator(const ArenaAllocator<U> &other)
+	: mArena(other.arena())
+{
+}
+
+template <typename T>
+T *ArenaAllocator<T>::allocate(size_t count)
+{
+	return static_cast<T *>(
+		mArena->allocate(count * sizeof(T), alignof(T)));
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T *, size_t)
+{
+}
+
+template <typename T>
+MemoryArena *ArenaAllocator<T>::arena() const
+{
+	return mArena;
+}
+
+MemoryArena *MemoryArenaLease::arena() const
+{
+	return mArena;
+}
@@ -0,0 +1,301 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "PixelConversion.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define PIXEL_CONVERSION_X86
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using InstructionSet = PixelConversion::InstructionSet;
+
+static InstructionSet detectInstructionSet()
+{
+#ifdef PIXEL_CONVERSION_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse2 = 0 != (info[3] & (1 << 26));
+	bool osxsave = 0 != (info[2] & (1 << 27));
+	bool avx = 0 != (info[2] & (1 << 28));
+
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(info, 7, 0);
+
+		if (info[1] & (1 << 5))
+			return PixelConversion::AVX2;
+	}
+
+	if (sse2)
+		return PixelConversion::SSE2;
+#else
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PixelConversion::AVX2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return PixelConversion::SSE2;
+#endif
+#endif
+	return PixelConversion::SCALAR;
+}
+
+static InstructionSet instructionSetInUse()
+{
+	static const InstructionSet isa = detectInstructionSet();
+	return isa;
+}
+
+void PixelConversion::argbToRgbaScalar(
+	const quint8 *src, quint8 *dst, int pixelCount, bool alpha)
+{
+	for (int i = 0; i < pixelCount; i++)
+	{
+		quint8 a = *src++;
+		quint8 r = *src++;
+		quint8 g = *src++;
+		quint8 b = *src++;
+		*dst++ = r;
+		*dst++ = g;
+		*dst++ = b;
+		*dst++ = alpha ? a : 255;
+	}
+}
+
+void PixelConversion::mergeAlphaScalar(
+	quint8 *rgba, const quint8 *alpha, int pixelCount)
+{
+	rgba += 3;
+
+	for (int i = 0; i < pixelCount; i++)
+	{
+		*rgba = *alpha++;
+		rgba += 4;
+	}
+}
+
+#ifdef PIXEL_CONVERSION_X86
+// Pixels are loaded as little-endian 32-bit words:
+// ARGB bytes become 0xBGRA and RGBA bytes become 0xABGR,
+// so the conversion is a rotation by 8 bits.
+
+TARGET_SSE2 static void argbToRgbaSSE2(
+	const quint8 *src, quint8 *dst, int pixelCount, bool alpha)
+{
+	const __m128i alphaMask =
+		_mm_set1_epi32(alpha ? 0 : int(0xFF000000));
+
+	int i = 0;
+
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		__m128i v =
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		v = _mm_or_si128(_mm_srli_epi32(v, 8), _mm_slli_epi32(v, 24));
+		v = _mm_or_si128(v, alphaMask);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+		src += 16;
+		dst += 16;
+	}
+
+	PixelConversion::argbToRgbaScalar(src, dst, pixelCount - i, alpha);
+}
+
+TARGET_AVX2 static void argbToRgbaAVX2(
+	const quint8 *src, quint8 *dst, int pixelCount, bool alpha)
+{
+	const __m256i alphaMask =
+		_mm256_set1_epi32(alpha ? 0 : int(0xFF000000));
+
+	int i = 0;
+
+	for (; i + 8 <= pixelCount; i += 8)
+	{
+		__m256i v =
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+		v = _mm256_or_si256(
+			_mm256_srli_epi32(v, 8), _mm256_slli_epi32(v, 24));
+		v = _mm256_or_si256(v, alphaMask);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), v);
+		src += 32;
+		dst += 32;
+	}
+
+	argbToRgbaSSE2(src, dst, pixelCount - i, alpha);
+}
+
+TARGET_SSE2 static void mergeAlphaSSE2(
+	quint8 *rgba, const quint8 *alpha, int pixelCount)
+{
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i zero = _mm_setzero_si128();
+
+	int i = 0;
+
+	for (; i + 16 <= pixelCount; i += 16)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha));
+		// Move each alpha byte to the top byte of a 32-bit word
+		__m128i lo16 = _mm_unpacklo_epi8(zero, a);
+		__m128i hi16 = _mm_unpackhi_epi8(zero, a);
+		__m128i a32[4] = { _mm_unpacklo_epi16(zero, lo16),
+			_mm_unpackhi_epi16(zero, lo16), _mm_unpacklo_epi16(zero, hi16),
+			_mm_unpackhi_epi16(zero, hi16) };
+
+		for (int j = 0; j < 4; j++)
+		{
+			auto p = reinterpret_cast<__m128i *>(rgba) + j;
+			__m128i v = _mm_loadu_si128(p);
+			v = _mm_or_si128(_mm_and_si128(v, colorMask), a32[j]);
+			_mm_storeu_si128(p, v);
+		}
+
+		rgba += 64;
+		alpha += 16;
+	}
+
+	PixelConversion::mergeAlphaScalar(rgba, alpha, pixelCount - i);
+}
+
+TARGET_AVX2 static void mergeAlphaAVX2(
+	quint8 *rgba, const quint8 *alpha, int pixelCount)
+{
+	const __m256i colorMask = _mm256_set1_epi32(0x00FFFFFF);
+
+	int i = 0;
+
+	for (; i + 8 <= pixelCount; i += 8)
+	{
+		__m128i a =
+			_mm_loadl_epi64(reinterpret_cast<const __m128i *>(alpha));
+		__m256i a32 = _mm256_slli_epi32(_mm256_cvtepu8_epi32(a), 24);
+
+		auto p = reinterpret_cast<__m256i *>(rgba);
+		__m256i v = _mm256_loadu_si256(p);
+		v = _mm256_or_si256(_mm256_and_si256(v, colorMask), a32);
+		_mm256_storeu_si256(p, v);
+
+		rgba += 32;
+		alpha += 8;
+	}
+
+	PixelConversion::mergeAlphaScalar(rgba, alpha, pixelCount - i);
+}
+#endif
+
+void PixelConversion::argbToRgba(
+	const quint8 *src, quint8 *dst, int pixelCount, bool alpha)
+{
+	argbToRgba(instructionSetInUse(), src, dst, pixelCount, alpha);
+}
+
+void PixelConversion::mergeAlpha(
+	quint8 *rgba, const quint8 *alpha, int pixelCount)
+{
+	mergeAlpha(instructionSetInUse(), rgba, alpha, pixelCount);
+}
+
+bool PixelConversion::isSupported(InstructionSet isa)
+{
+	switch (isa)
+	{
+		case SCALAR:
+			return true;
+
+		case SSE2:
+			return instructionSetInUse() != SCALAR;
+
+		case AVX2:
+			return instructionSetInUse() == AVX2;
+	}
+
+	return false;
+}
+
+void PixelConversion::argbToRgba(InstructionSet isa, const quint8 *src,
+	quint8 *dst, int pixelCount, bool alpha)
+{
+	Q_ASSERT(isSupported(isa));
+
+	switch (isa)
+	{
+#ifdef PIXEL_CONVERSION_X86
+		case AVX2:
+			argbToRgbaAVX2(src, dst, pixelCount, alpha);
+			return;
+
+		case SSE2:
+			argbToRgbaSSE2(src, dst, pixelCount, alpha);
+			return;
+#endif
+		default:
+			break;
+	}
+
+	argbToRgbaScalar(src, dst, pixelCount, alpha);
+}
+
+void PixelConversion::mergeAlpha(InstructionSet isa, quint8 *rgba,
+	const quint8 *alpha, int pixelCount)
+{
+	Q_ASSERT(isSupported(isa));
+
+	switch (isa)
+	{
+#ifdef PIXEL_CONVERSION_X86
+		case AVX2:
+			mergeAlphaAVX2(rgba, alpha, pixelCount);
+			return;
+
+		case SSE2:
+			mergeAlphaSSE2(rgba, alpha, pixelCount);
+			return;
+#endif
+		default:
+			break;
+	}
+
+	mergeAlphaScalar(rgba, alpha, pixelCount);
+}
+
+const char *PixelConversion::instructionSet()
+{
+	return instructionSetName(instructionSetInUse());
+}
+
+const char *PixelConversion::instructionSetName(InstructionSet isa)
+{
+	switch (isa)
+	{
+		case AVX2:
+			return "AVX2";
+
+		case SSE2:
+			return "SSE2";
+
+		case SCALAR:
+			break;
+	}
+
+	return "scalar";
+}
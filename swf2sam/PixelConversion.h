@@ -0,0 +1,48 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QtGlobal>
+
+// Pixel conversion kernels used to decode SWF bitmaps.
+// SSE2 or AVX2 implementation is picked at runtime
+// depending on the CPU, scalar versions are used as a fallback
+// and as a reference for the vectorized ones.
+class PixelConversion
+{
+public:
+	enum InstructionSet
+	{
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	// Converts SWF lossless 32-bit ARGB pixels to RGBA byte order.
+	// If alpha is false, the alpha channel is set to 255.
+	static void argbToRgba(
+		const quint8 *src, quint8 *dst, int pixelCount, bool alpha);
+
+	// Writes alpha values into every 4th byte of RGBA pixels
+	static void mergeAlpha(quint8 *rgba, const quint8 *alpha, int pixelCount);
+
+	static void argbToRgbaScalar(
+		const quint8 *src, quint8 *dst, int pixelCount, bool alpha);
+
+	static void mergeAlphaScalar(
+		quint8 *rgba, const quint8 *alpha, int pixelCount);
+
+	// Kernels of the given instruction set, so tests can check
+	// every supported one against the scalar versions
+	static bool isSupported(InstructionSet isa);
+	static void argbToRgba(InstructionSet isa, const quint8 *src,
+		quint8 *dst, int pixelCount, bool alpha);
+	static void mergeAlpha(InstructionSet isa, quint8 *rgba,
+		const quint8 *alpha, int pixelCount);
+
+	static const char *instructionSet();
+	static const char *instructionSetName(InstructionSet isa);
+};
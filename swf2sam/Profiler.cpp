@@ -0,0 +1,337 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "Profiler.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <map>
+
+enum
+{
+	SLOWEST_SUBJECT_COUNT = 20
+};
+
+static const char IMAGE_STAGE_PREFIX[] = "image.";
+
+Profiler::Scope::Scope(
+	Profiler *profiler, const char *stage, const QString &subject)
+	: mProfiler(profiler)
+	, mStage(stage)
+	, mSubject(subject)
+	, mStartNs(0)
+	, mBytes(0)
+{
+	if (nullptr != mProfiler)
+		mStartNs = mProfiler->elapsedNs();
+}
+
+Profiler::Scope::~Scope()
+{
+	finish();
+}
+
+void Profiler::Scope::finish()
+{
+	if (nullptr == mProfiler)
+		return;
+
+	mProfiler->record(mStage, mSubject, mStartNs,
+		mProfiler->elapsedNs() - mStartNs, mBytes);
+	mProfiler = nullptr;
+}
+
+Profiler::Profiler()
+{
+	mTimer.start();
+}
+
+bool Profiler::parseFormat(const QString &str, Format *format)
+{
+	Q_ASSERT(nullptr != format);
+
+	if (str == "table")
+	{
+		*format = TABLE;
+		return true;
+	}
+
+	if (str == "json")
+	{
+		*format = JSON;
+		return true;
+	}
+
+	if (str == "trace")
+	{
+		*format = TRACE;
+		return true;
+	}
+
+	return false;
+}
+
+qint64 Profiler::elapsedNs() const
+{
+	return mTimer.nsecsElapsed();
+}
+
+void Profiler::record(const char *stage, const QString &subject,
+	qint64 startNs, qint64 durationNs, qint64 bytes)
+{
+	Event event;
+	event.stage = stage;
+	event.subject = subject;
+	event.startNs = startNs;
+	event.durationNs = durationNs;
+	event.bytes = bytes;
+	event.threadId = quintptr(QThread::currentThreadId());
+
+	QMutexLocker lock(&mMutex);
+	mEvents.push_back(event);
+}
+
+Profiler::Events Profiler::events() const
+{
+	QMutexLocker lock(&mMutex);
+	return mEvents;
+}
+
+QByteArray Profiler::report(Format format) const
+{
+	switch (format)
+	{
+		case TABLE:
+			return tableReport();
+
+		case JSON:
+			return jsonReport();
+
+		case TRACE:
+			return traceReport();
+	}
+
+	return QByteArray();
+}
+
+struct ProfilerTotals
+{
+	QString name;
+	qint64 count;
+	qint64 totalNs;
+	qint64 maxNs;
+	qint64 bytes;
+
+	ProfilerTotals();
+
+	void add(const Profiler::Event &event);
+
+	static std::vector<ProfilerTotals> sorted(
+		const std::map<QString, ProfilerTotals> &map);
+};
+
+ProfilerTotals::ProfilerTotals()
+	: count(0)
+	, totalNs(0)
+	, maxNs(0)
+	, bytes(0)
+{
+}
+
+void ProfilerTotals::add(const Profiler::Event &event)
+{
+	count++;
+	totalNs += event.durationNs;
+	maxNs = std::max(maxNs, event.durationNs);
+	bytes += event.bytes;
+}
+
+std::vector<ProfilerTotals> ProfilerTotals::sorted(
+	const std::map<QString, ProfilerTotals> &map)
+{
+	std::vector<ProfilerTotals> result;
+	result.reserve(map.size());
+
+	for (auto &it : map)
+	{
+		result.push_back(it.second);
+		result.back().name = it.first;
+	}
+
+	std::stable_sort(result.begin(), result.end(),
+		[](const ProfilerTotals &a, const ProfilerTotals &b) -> bool {
+			return a.totalNs > b.totalNs;
+		});
+
+	return result;
+}
+
+static QString msecs(qint64 ns)
+{
+	return QString::number(ns / 1000000.0, 'f', 3);
+}
+
+QByteArray Profiler::tableReport() const
+{
+	auto events = this->events();
+
+	std::map<QString, ProfilerTotals> stages;
+	std::map<QString, ProfilerTotals> subjects;
+
+	for (auto &event : events)
+	{
+		stages[QString::fromLatin1(event.stage)].add(event);
+
+		if (0 ==
+			qstrncmp(event.stage, IMAGE_STAGE_PREFIX,
+				sizeof(IMAGE_STAGE_PREFIX) - 1))
+		{
+			subjects[event.subject].add(event);
+		}
+	}
+
+	QStringList lines;
+
+	static const QString rowFmt("%1 %2 %3 %4 %5 %6 %7");
+
+	lines.append(rowFmt.arg("Stage", -24)
+					 .arg("Count", 8)
+					 .arg("Total ms", 12)
+					 .arg("Mean ms", 10)
+					 .arg("Max ms", 10)
+					 .arg("MiB", 10)
+					 .arg("MiB/s", 10));
+
+	for (auto &totals : ProfilerTotals::sorted(stages))
+	{
+		qreal mib = totals.bytes / (1024.0 * 1024.0);
+		qreal seconds = totals.totalNs / 1000000000.0;
+
+		lines.append(rowFmt.arg(totals.name, -24)
+						 .arg(totals.count, 8)
+						 .arg(msecs(totals.totalNs), 12)
+						 .arg(msecs(totals.totalNs / totals.count), 10)
+						 .arg(msecs(totals.maxNs), 10)
+						 .arg(QString::number(mib, 'f', 2), 10)
+						 .arg(seconds > 0.0
+								 ? QString::number(mib / seconds, 'f', 2)
+								 : QString("-"),
+							 10));
+	}
+
+	auto slowest = ProfilerTotals::sorted(subjects);
+
+	if (not slowest.empty())
+	{
+		lines.append(QString());
+		lines.append(QString("%1 %2").arg("Slowest images", -40).arg(
+			"Total ms", 12));
+
+		if (slowest.size() > SLOWEST_SUBJECT_COUNT)
+			slowest.resize(SLOWEST_SUBJECT_COUNT);
+
+		for (auto &totals : slowest)
+		{
+			lines.append(QString("%1 %2")
+							 .arg(totals.name, -40)
+							 .arg(msecs(totals.totalNs), 12));
+		}
+	}
+
+	lines.append(QString());
+	return lines.join('\n').toUtf8();
+}
+
+QByteArray Profiler::jsonReport() const
+{
+	auto events = this->events();
+
+	std::map<QString, ProfilerTotals> stages;
+
+	QJsonArray eventArray;
+
+	for (auto &event : events)
+	{
+		stages[QString::fromLatin1(event.stage)].add(event);
+
+		QJsonObject obj;
+		obj.insert("stage", QString::fromLatin1(event.stage));
+		obj.insert("subject", event.subject);
+		obj.insert("start_ns", double(event.startNs));
+		obj.insert("duration_ns", double(event.durationNs));
+		obj.insert("bytes", double(event.bytes));
+		eventArray.append(obj);
+	}
+
+	QJsonArray stageArray;
+
+	for (auto &totals : ProfilerTotals::sorted(stages))
+	{
+		QJsonObject obj;
+		obj.insert("stage", totals.name);
+		obj.insert("count", double(totals.count));
+		obj.insert("total_ns", double(totals.totalNs));
+		obj.insert("max_ns", double(totals.maxNs));
+		obj.insert("bytes", double(totals.bytes));
+		stageArray.append(obj);
+	}
+
+	QJsonObject root;
+	root.insert("stages", stageArray);
+	root.insert("events", eventArray);
+
+	return QJsonDocument(root).toJson();
+}
+
+QByteArray Profiler::traceReport() const
+{
+	auto events = this->events();
+
+	// Chrome trace viewer expects small thread ids
+	std::map<quintptr, int> threadIds;
+
+	QJsonArray traceEvents;
+
+	for (auto &event : events)
+	{
+		auto it = threadIds.find(event.threadId);
+
+		if (it == threadIds.end())
+		{
+			it = threadIds
+					 .insert(std::make_pair(
+						 event.threadId, int(threadIds.size() + 1)))
+					 .first;
+		}
+
+		QJsonObject args;
+		args.insert("subject", event.subject);
+
+		if (event.bytes > 0)
+			args.insert("bytes", double(event.bytes));
+
+		QJsonObject obj;
+		obj.insert("name", QString::fromLatin1(event.stage));
+		obj.insert("cat", QString("swf2sam"));
+		obj.insert("ph", QString("X"));
+		obj.insert("ts", event.startNs / 1000.0);
+		obj.insert("dur", event.durationNs / 1000.0);
+		obj.insert("pid", 1);
+		obj.insert("tid", it->second);
+		obj.insert("args", args);
+		traceEvents.append(obj);
+	}
+
+	QJsonObject root;
+	root.insert("traceEvents", traceEvents);
+	root.insert("displayTimeUnit", QString("ms"));
+
+	return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
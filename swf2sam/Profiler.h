@@ -0,0 +1,80 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+
+#include <vector>
+
+// Thread-safe collector of conversion stage timings.
+// Events are grouped by stage name (like "image.encode") and
+// subject (input SWF-file or image file name).
+class Profiler
+{
+public:
+	enum Format
+	{
+		TABLE,
+		JSON,
+		TRACE
+	};
+
+	struct Event
+	{
+		const char *stage;
+		QString subject;
+		qint64 startNs;
+		qint64 durationNs;
+		qint64 bytes;
+		quintptr threadId;
+	};
+
+	using Events = std::vector<Event>;
+
+	class Scope
+	{
+	public:
+		Scope(Profiler *profiler, const char *stage, const QString &subject);
+		~Scope();
+
+		inline void setBytes(qint64 bytes);
+		void finish();
+
+	private:
+		Profiler *mProfiler;
+		const char *mStage;
+		QString mSubject;
+		qint64 mStartNs;
+		qint64 mBytes;
+	};
+
+	Profiler();
+
+	static bool parseFormat(const QString &str, Format *format);
+
+	qint64 elapsedNs() const;
+	void record(const char *stage, const QString &subject, qint64 startNs,
+		qint64 durationNs, qint64 bytes);
+
+	Events events() const;
+	QByteArray report(Format format) const;
+
+private:
+	QByteArray tableReport() const;
+	QByteArray jsonReport() const;
+	QByteArray traceReport() const;
+
+	mutable QMutex mMutex;
+	QElapsedTimer mTimer;
+	Events mEvents;
+};
+
+void Profiler::Scope::setBytes(qint64 bytes)
+{
+	mBytes = bytes;
+}
@@ -47,9 +47,8 @@ static int seek(reader_t *reader, int pos)
 
 static void dealloc(reader_t *reader)
 {
-	auto device = getDevice(reader);
-
-	device->close();
+	// Device is closed by its owner
+	getDevice(reader);
 
 	memset(reader, 0, sizeof(reader_t));
 }
@@ -0,0 +1,255 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "SAMCompressor.h"
+
+#include <QtEndian>
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstring>
+#include <memory>
+
+// Compressed SAM-file, all fields are little-endian:
+// - SAMZ_Signature;
+// - 8-bit method, 1 is zlib and 2 is zstd;
+// - 32-bit block size;
+// - 32-bit size of the whole uncompressed SAM-file;
+// - blocks of 32-bit compressed size followed by zlib stream or
+//   zstd frame. Every block but the last one is decompressed
+//   to block size bytes.
+static const char SAMZ_Signature[] = "MASZ";
+
+enum
+{
+	SAMZ_SIGN_SIZE = sizeof(SAMZ_Signature) - 1,
+	SAMZ_HEADER_SIZE = SAMZ_SIGN_SIZE + 1 + 4 + 4,
+	SAMZ_BLOCK_HEADER_SIZE = 4
+};
+
+struct MethodName
+{
+	const char *name;
+	SAMCompressor::Method value;
+};
+
+static const MethodName METHOD_NAMES[] = {
+	{"none", SAMCompressor::NONE},
+	{"zlib", SAMCompressor::ZLIB},
+#ifdef HAVE_ZSTD
+	{"zstd", SAMCompressor::ZSTD},
+#endif
+};
+
+static void appendUInt32(QByteArray *output, quint32 value)
+{
+	uchar data[sizeof(value)];
+	qToLittleEndian(value, data);
+	output->append(reinterpret_cast<const char *>(data), sizeof(data));
+}
+
+static void writeHeader(SAMCompressor::Method method, int size,
+	QByteArray *output)
+{
+	output->append(SAMZ_Signature, SAMZ_SIGN_SIZE);
+	output->append(char(method));
+	appendUInt32(output, quint32(SAMCompressor::BLOCK_SIZE));
+	appendUInt32(output, quint32(size));
+}
+
+static inline int blockCount(int size)
+{
+	return (size + SAMCompressor::BLOCK_SIZE - 1) / SAMCompressor::BLOCK_SIZE;
+}
+
+SAMCompressor::SAMCompressor()
+	: mMethod(NONE)
+	, mCompressionLevel(DEFAULT_LEVEL)
+{
+}
+
+bool SAMCompressor::parseMethod(const QString &str, Method *method)
+{
+	Q_ASSERT(nullptr != method);
+
+	for (auto &m : METHOD_NAMES)
+	{
+		if (0 == str.compare(QLatin1String(m.name), Qt::CaseInsensitive))
+		{
+			*method = m.value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SAMCompressor::parseCompressionLevel(const QString &str, int *level)
+{
+	Q_ASSERT(nullptr != level);
+
+	bool ok;
+	int value = str.toInt(&ok);
+
+	if (not ok || value < DEFAULT_LEVEL || value > MAX_ZSTD_LEVEL)
+		return false;
+
+	*level = value;
+	return true;
+}
+
+bool SAMCompressor::isValid() const
+{
+	switch (mMethod)
+	{
+		case NONE:
+			return true;
+
+		case ZLIB:
+			return mCompressionLevel >= DEFAULT_LEVEL &&
+				mCompressionLevel <= MAX_ZLIB_LEVEL;
+
+		case ZSTD:
+#ifdef HAVE_ZSTD
+			// Level 0 means the default one in zstd
+			return mCompressionLevel == DEFAULT_LEVEL ||
+				(mCompressionLevel > 0 &&
+					mCompressionLevel <= MAX_ZSTD_LEVEL);
+#else
+			return false;
+#endif
+	}
+
+	return false;
+}
+
+QByteArray SAMCompressor::key() const
+{
+	return QString("%1:%2:%3")
+		.arg(int(mMethod))
+		.arg(mCompressionLevel)
+		.arg(int(BLOCK_SIZE))
+		.toLatin1();
+}
+
+bool SAMCompressor::compress(const QByteArray &sam, QByteArray *output) const
+{
+	Q_ASSERT(nullptr != output);
+
+	output->clear();
+
+	if (not isValid())
+		return false;
+
+	switch (mMethod)
+	{
+		case NONE:
+			*output = sam;
+			return true;
+
+		case ZLIB:
+			return compressZlib(sam, output);
+
+		case ZSTD:
+			return compressZstd(sam, output);
+	}
+
+	return false;
+}
+
+bool SAMCompressor::compressZlib(
+	const QByteArray &sam, QByteArray *output) const
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+
+	if (Z_OK != deflateInit(&zs, mCompressionLevel))
+		return false;
+
+	int blockBound = int(deflateBound(&zs, uLong(BLOCK_SIZE)));
+	output->reserve(SAMZ_HEADER_SIZE +
+		blockCount(sam.size()) * (SAMZ_BLOCK_HEADER_SIZE + blockBound));
+	writeHeader(ZLIB, sam.size(), output);
+
+	QByteArray block(blockBound, Qt::Uninitialized);
+	bool ok = true;
+
+	// Every block is a complete zlib stream, deflate state is only reset
+	for (int offset = 0; ok && offset < sam.size(); offset += BLOCK_SIZE)
+	{
+		int size = qMin(int(BLOCK_SIZE), sam.size() - offset);
+
+		zs.next_in = reinterpret_cast<Bytef *>(
+			const_cast<char *>(sam.constData() + offset));
+		zs.avail_in = uInt(size);
+		zs.next_out = reinterpret_cast<Bytef *>(block.data());
+		zs.avail_out = uInt(block.size());
+
+		ok = Z_STREAM_END == deflate(&zs, Z_FINISH);
+
+		if (ok)
+		{
+			appendUInt32(output, quint32(zs.total_out));
+			output->append(block.constData(), int(zs.total_out));
+			ok = Z_OK == deflateReset(&zs);
+		}
+	}
+
+	deflateEnd(&zs);
+
+	if (not ok)
+		output->clear();
+
+	return ok;
+}
+
+bool SAMCompressor::compressZstd(
+	const QByteArray &sam, QByteArray *output) const
+{
+#ifdef HAVE_ZSTD
+	std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> context(
+		ZSTD_createCCtx(), ZSTD_freeCCtx);
+
+	if (nullptr == context)
+		return false;
+
+	int level = mCompressionLevel == DEFAULT_LEVEL ? 0 : mCompressionLevel;
+	int blockBound = int(ZSTD_compressBound(size_t(BLOCK_SIZE)));
+	output->reserve(SAMZ_HEADER_SIZE +
+		blockCount(sam.size()) * (SAMZ_BLOCK_HEADER_SIZE + blockBound));
+	writeHeader(ZSTD, sam.size(), output);
+
+	QByteArray block(blockBound, Qt::Uninitialized);
+
+	// Every block is a complete zstd frame, the context is reused
+	for (int offset = 0; offset < sam.size(); offset += BLOCK_SIZE)
+	{
+		int size = qMin(int(BLOCK_SIZE), sam.size() - offset);
+
+		auto compressedSize = ZSTD_compressCCtx(context.get(), block.data(),
+			size_t(block.size()), sam.constData() + offset, size_t(size),
+			level);
+
+		if (ZSTD_isError(compressedSize))
+		{
+			output->clear();
+			return false;
+		}
+
+		appendUInt32(output, quint32(compressedSize));
+		output->append(block.constData(), int(compressedSize));
+	}
+
+	return true;
+#else
+	Q_UNUSED(sam);
+	Q_UNUSED(output);
+	return false;
+#endif
+}
@@ -0,0 +1,89 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Wraps a whole SAM-file into a compressed envelope. SAM data is cut
+// into blocks compressed independently with zlib or zstd, so a player
+// can decompress one block at a time while parsing, keeping only
+// a block of compressed and uncompressed data in memory.
+class SAMCompressor
+{
+public:
+	enum Method
+	{
+		NONE,
+		ZLIB,
+		ZSTD
+	};
+
+	enum
+	{
+		DEFAULT_LEVEL = -1,
+		MAX_ZLIB_LEVEL = 9,
+		MAX_ZSTD_LEVEL = 22
+	};
+
+	enum
+	{
+		BLOCK_SIZE = 128 * 1024
+	};
+
+	SAMCompressor();
+
+	inline Method method() const;
+	inline int compressionLevel() const;
+
+	inline void setMethod(Method method);
+	inline void setCompressionLevel(int level);
+
+	static bool parseMethod(const QString &str, Method *method);
+	static bool parseCompressionLevel(const QString &str, int *level);
+
+	inline bool isEnabled() const;
+
+	// Compression level is in range of the method
+	bool isValid() const;
+
+	// Identifies compressed output for build manifests
+	QByteArray key() const;
+
+	bool compress(const QByteArray &sam, QByteArray *output) const;
+
+private:
+	bool compressZlib(const QByteArray &sam, QByteArray *output) const;
+	bool compressZstd(const QByteArray &sam, QByteArray *output) const;
+
+	Method mMethod;
+	int mCompressionLevel;
+};
+
+SAMCompressor::Method SAMCompressor::method() const
+{
+	return mMethod;
+}
+
+int SAMCompressor::compressionLevel() const
+{
+	return mCompressionLevel;
+}
+
+void SAMCompressor::setMethod(Method method)
+{
+	mMethod = method;
+}
+
+void SAMCompressor::setCompressionLevel(int level)
+{
+	mCompressionLevel = level;
+}
+
+bool SAMCompressor::isEnabled() const
+{
+	return mMethod != NONE;
+}
@@ -0,0 +1,70 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "SegmentedDevice.h"
+
+#include <algorithm>
+#include <cstring>
+
+SegmentedDevice::SegmentedDevice()
+	: mSize(0)
+{
+}
+
+void SegmentedDevice::addSegment(const char *data, qint64 size)
+{
+	Q_ASSERT(not isOpen());
+
+	if (size <= 0)
+		return;
+
+	Segment segment;
+	segment.data = data;
+	segment.offset = mSize;
+	segment.size = size;
+	mSegments.push_back(segment);
+
+	mSize += size;
+}
+
+bool SegmentedDevice::isSequential() const
+{
+	return false;
+}
+
+qint64 SegmentedDevice::size() const
+{
+	return mSize;
+}
+
+qint64 SegmentedDevice::readData(char *data, qint64 maxSize)
+{
+	qint64 position = pos();
+
+	// First segment ending after the position
+	auto it = std::upper_bound(mSegments.begin(), mSegments.end(), position,
+		[](qint64 value, const Segment &segment) {
+			return value < segment.offset + segment.size;
+		});
+
+	qint64 readSize = 0;
+
+	for (; it != mSegments.end() && readSize < maxSize; ++it)
+	{
+		qint64 skip = position - it->offset;
+		qint64 len = qMin(it->size - skip, maxSize - readSize);
+
+		memcpy(data + readSize, it->data + skip, size_t(len));
+		readSize += len;
+		position += len;
+	}
+
+	return readSize;
+}
+
+qint64 SegmentedDevice::writeData(const char *, qint64)
+{
+	return -1;
+}
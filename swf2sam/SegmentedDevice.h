@@ -0,0 +1,47 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QIODevice>
+
+#include <vector>
+
+// Read-only random access device presenting several memory segments
+// as one stream. Segments are not copied and must stay valid
+// while the device is read.
+class SegmentedDevice : public QIODevice
+{
+public:
+	struct Segment
+	{
+		const char *data;
+		qint64 offset;
+		qint64 size;
+	};
+
+	using Segments = std::vector<Segment>;
+
+	SegmentedDevice();
+
+	void addSegment(const char *data, qint64 size);
+	inline const Segments &segments() const;
+
+	bool isSequential() const override;
+	qint64 size() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	Segments mSegments;
+	qint64 mSize;
+};
+
+const SegmentedDevice::Segments &SegmentedDevice::segments() const
+{
+	return mSegments;
+}
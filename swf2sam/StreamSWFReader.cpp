@@ -0,0 +1,216 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "StreamSWFReader.h"
+
+#include "QIODeviceSWFReader.h"
+#include "MappedSWFReader.h"
+
+#include "rfxswf.h"
+
+#include <QIODevice>
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+enum
+{
+	SWF_HEADER_SIZE = 8,
+	TAG_SHORT_LEN_MASK = 0x3F,
+	RECT_MAX_SIZE = 17,
+	FIRST_CHUNK_SIZE = 64 * 1024
+};
+
+StreamSWFReader::StreamSWFReader()
+	: mReader(nullptr)
+	, mError(false)
+{
+	memset(&mDeviceReader, 0, sizeof(reader_t));
+	memset(&mInflateReader, 0, sizeof(reader_t));
+}
+
+StreamSWFReader::~StreamSWFReader()
+{
+	close();
+}
+
+bool StreamSWFReader::open(QIODevice *device, SWF *swf)
+{
+	Q_ASSERT(nullptr != device);
+	Q_ASSERT(nullptr != swf);
+	Q_ASSERT(nullptr == mReader);
+
+	memset(swf, 0, sizeof(SWF));
+	mError = false;
+
+	QIODeviceSWFReader::init(&mDeviceReader, device);
+	mReader = &mDeviceReader;
+
+	U8 header[SWF_HEADER_SIZE];
+
+	if (not readBytes(header, SWF_HEADER_SIZE))
+		return false;
+
+	if ((header[0] != 'F' && header[0] != 'C') || header[1] != 'W' ||
+		header[2] != 'S')
+	{
+		return false;
+	}
+
+	swf->fileVersion = header[3];
+	swf->fileSize = GET32(&header[4]);
+
+	if (header[0] == 'C')
+	{
+		reader_init_zlibinflate(&mInflateReader, &mDeviceReader);
+		mReader = &mInflateReader;
+	}
+
+	U8 rect[RECT_MAX_SIZE];
+
+	if (not readBytes(rect, 1))
+		return false;
+
+	int rectSize = (5 + (rect[0] >> 3) * 4 + 7) / 8;
+
+	if (rectSize > 1 && not readBytes(&rect[1], rectSize - 1))
+		return false;
+
+	if (MappedSWFReader::parseRect(rect, rectSize, &swf->movieSize) < 0)
+		return false;
+
+	U8 frameInfo[4];
+
+	if (not readBytes(frameInfo, 4))
+		return false;
+
+	swf->frameRate = GET16(&frameInfo[0]);
+	swf->frameCount = GET16(&frameInfo[2]);
+
+	return true;
+}
+
+void StreamSWFReader::close()
+{
+	if (nullptr == mReader)
+		return;
+
+	if (mReader == &mInflateReader)
+		mInflateReader.dealloc(&mInflateReader);
+
+	mDeviceReader.dealloc(&mDeviceReader);
+	mReader = nullptr;
+}
+
+TAG *StreamSWFReader::readTag()
+{
+	if (nullptr == mReader)
+		return nullptr;
+
+	U8 header[4];
+
+	int count = mReader->read(mReader, header, 2);
+
+	if (count != 2)
+	{
+		// Nothing left is the end of the file, not an error
+		mError = count != 0;
+		return nullptr;
+	}
+
+	U16 idAndLen = GET16(header);
+	U32 len = idAndLen & TAG_SHORT_LEN_MASK;
+
+	if (len == TAG_SHORT_LEN_MASK)
+	{
+		if (not readBytes(header, 4))
+		{
+			mError = true;
+			return nullptr;
+		}
+
+		len = GET32(header);
+	}
+
+	if (len > quint32(INT_MAX))
+	{
+		mError = true;
+		return nullptr;
+	}
+
+	auto tag = reinterpret_cast<TAG *>(calloc(1, sizeof(TAG)));
+
+	if (nullptr == tag)
+	{
+		mError = true;
+		return nullptr;
+	}
+
+	tag->id = idAndLen >> 6;
+	tag->len = len;
+	tag->memsize = len;
+
+	if (len > 0 && not readData(&tag->data, len))
+	{
+		freeTag(tag);
+		mError = true;
+		return nullptr;
+	}
+
+	return tag;
+}
+
+void StreamSWFReader::freeTag(TAG *tag)
+{
+	if (nullptr == tag)
+		return;
+
+	free(tag->data);
+	free(tag);
+}
+
+bool StreamSWFReader::readBytes(void *data, int len)
+{
+	return mReader->read(mReader, data, len) == len;
+}
+
+bool StreamSWFReader::readData(quint8 **data, quint32 len)
+{
+	// Tag length is not trusted, so the buffer grows while data is read
+	// and a malformed length can not allocate much more than the data
+	// left in the input
+	quint32 capacity = qMin(len, quint32(FIRST_CHUNK_SIZE));
+	quint32 size = 0;
+
+	auto buffer = reinterpret_cast<quint8 *>(malloc(capacity));
+
+	while (nullptr != buffer)
+	{
+		if (not readBytes(&buffer[size], int(capacity - size)))
+			break;
+
+		size = capacity;
+
+		if (size == len)
+		{
+			*data = buffer;
+			return true;
+		}
+
+		capacity = len - size > size ? size * 2 : len;
+
+		auto grown = reinterpret_cast<quint8 *>(realloc(buffer, capacity));
+
+		if (nullptr == grown)
+			break;
+
+		buffer = grown;
+	}
+
+	free(buffer);
+	return false;
+}
@@ -0,0 +1,57 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QtGlobal>
+
+class QIODevice;
+
+extern "C"
+{
+#include "bitio.h"
+
+struct _SWF;
+struct _TAG;
+}
+
+// Reads SWF tags one by one, so a converter can release each tag
+// as soon as no later tag can reference it.
+// Tags returned by readTag() are not linked and must be released
+// with freeTag().
+class StreamSWFReader
+{
+public:
+	StreamSWFReader();
+	~StreamSWFReader();
+
+	// Reads the SWF header; swf->firstTag is left empty
+	bool open(QIODevice *device, struct _SWF *swf);
+	void close();
+
+	// Returns nullptr when there are no more tags or on error
+	struct _TAG *readTag();
+
+	// Last readTag() failed on truncated or malformed data
+	// instead of reaching the end of the file
+	inline bool hasError() const;
+
+	static void freeTag(struct _TAG *tag);
+
+private:
+	bool readBytes(void *data, int len);
+	bool readData(quint8 **data, quint32 len);
+
+	reader_t mDeviceReader;
+	reader_t mInflateReader;
+	reader_t *mReader;
+	bool mError;
+};
+
+bool StreamSWFReader::hasError() const
+{
+	return mError;
+}
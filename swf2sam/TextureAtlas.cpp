@@ -0,0 +1,263 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "TextureAtlas.h"
+
+#include <QImage>
+
+#include <algorithm>
+
+static int nextPowerOfTwo(int value)
+{
+	int result = 1;
+
+	while (result < value)
+		result <<= 1;
+
+	return result;
+}
+
+TextureAtlas::TextureAtlas(int maxPageSize, int padding, int extrude)
+	: mMaxPageSize(maxPageSize)
+	, mPadding(padding)
+	, mExtrude(extrude)
+{
+	Q_ASSERT(isPowerOfTwo(maxPageSize));
+	Q_ASSERT(padding >= 0);
+	Q_ASSERT(extrude >= 0);
+}
+
+bool TextureAtlas::isPowerOfTwo(int value)
+{
+	return value > 0 && 0 == (value & (value - 1));
+}
+
+bool TextureAtlas::fits(const QSize &size) const
+{
+	int border = mExtrude * 2 + mPadding;
+
+	return size.width() + border <= mMaxPageSize &&
+		size.height() + border <= mMaxPageSize;
+}
+
+TextureAtlas::Placements TextureAtlas::pack(const Sizes &sizes)
+{
+	mPages.clear();
+	mPageSizes.clear();
+
+	Placements result(sizes.size());
+
+	// Taller images first make shelves of the skyline even
+	std::vector<size_t> order(sizes.size());
+
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+		auto &sa = sizes.at(a);
+		auto &sb = sizes.at(b);
+
+		if (sa.height() != sb.height())
+			return sa.height() > sb.height();
+
+		return sa.width() > sb.width();
+	});
+
+	int border = mExtrude * 2 + mPadding;
+
+	for (size_t index : order)
+	{
+		auto &size = sizes.at(index);
+		Q_ASSERT(fits(size));
+		QSize cell(size.width() + border, size.height() + border);
+
+		QPoint pos;
+		size_t at = 0;
+		size_t pageIndex = 0;
+
+		for (; pageIndex < mPages.size(); pageIndex++)
+		{
+			if (findPosition(mPages.at(pageIndex), cell, &pos, &at))
+				break;
+		}
+
+		if (pageIndex == mPages.size())
+		{
+			addPage(QSize(mMaxPageSize, mMaxPageSize));
+
+			bool found = findPosition(mPages.back(), cell, &pos, &at);
+			Q_ASSERT(found);
+			Q_UNUSED(found);
+		}
+
+		insert(mPages.at(pageIndex), at, pos, cell);
+
+		auto &placement = result.at(index);
+		placement.page = int(pageIndex);
+		placement.rect = QRect(pos.x() + mExtrude, pos.y() + mExtrude,
+			size.width(), size.height());
+	}
+
+	// Shrink pages to the smallest power-of-two size holding their images
+	for (auto &page : mPages)
+	{
+		mPageSizes.push_back(QSize(nextPowerOfTwo(page.used.width()),
+			nextPowerOfTwo(page.used.height())));
+	}
+
+	mPages.clear();
+
+	return result;
+}
+
+void TextureAtlas::addPage(const QSize &size)
+{
+	Page page;
+	page.size = size;
+	page.used = QSize(1, 1);
+	page.skyline.push_back({0, 0, size.width()});
+
+	mPages.push_back(page);
+}
+
+bool TextureAtlas::findPosition(
+	const Page &page, const QSize &cell, QPoint *pos, size_t *at) const
+{
+	auto &skyline = page.skyline;
+
+	int bestY = -1;
+	int bestX = 0;
+	size_t bestAt = 0;
+
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		int x = skyline[i].x;
+
+		if (x + cell.width() > page.size.width())
+			break;
+
+		// Lowest position the cell can rest on spanning segments from i
+		int y = 0;
+		int widthLeft = cell.width();
+
+		for (size_t j = i; widthLeft > 0; j++)
+		{
+			Q_ASSERT(j < skyline.size());
+			y = qMax(y, skyline[j].y);
+			widthLeft -= skyline[j].width;
+		}
+
+		if (y + cell.height() > page.size.height())
+			continue;
+
+		if (bestY < 0 || y < bestY)
+		{
+			bestY = y;
+			bestX = x;
+			bestAt = i;
+		}
+	}
+
+	if (bestY < 0)
+		return false;
+
+	*pos = QPoint(bestX, bestY);
+	*at = bestAt;
+	return true;
+}
+
+void TextureAtlas::insert(
+	Page &page, size_t at, const QPoint &pos, const QSize &cell)
+{
+	auto &skyline = page.skyline;
+
+	Segment segment = {pos.x(), pos.y() + cell.height(), cell.width()};
+	skyline.insert(skyline.begin() + at, segment);
+
+	// Cut segments covered by the new one
+	int right = segment.x + segment.width;
+
+	for (size_t i = at + 1; i < skyline.size();)
+	{
+		auto &s = skyline[i];
+
+		if (s.x >= right)
+			break;
+
+		int shrink = right - s.x;
+
+		if (shrink < s.width)
+		{
+			s.x += shrink;
+			s.width -= shrink;
+			break;
+		}
+
+		skyline.erase(skyline.begin() + i);
+	}
+
+	// Merge neighbours of equal height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+			continue;
+		}
+
+		i++;
+	}
+
+	// Padding of the rightmost and bottom cells is not needed
+	int usedWidth = qMin(page.size.width(), right - mPadding);
+	int usedHeight = qMin(page.size.height(), segment.y - mPadding);
+
+	page.used = page.used.expandedTo(QSize(usedWidth, usedHeight));
+}
+
+void TextureAtlas::draw(
+	QImage &page, const QImage &image, const QRect &rect) const
+{
+	Q_ASSERT(page.format() == QImage::Format_RGBA8888_Premultiplied);
+	Q_ASSERT(image.format() == QImage::Format_RGBA8888_Premultiplied);
+	Q_ASSERT(image.size() == rect.size());
+
+	enum
+	{
+		BPP = 4
+	};
+
+	int width = rect.width();
+	int height = rect.height();
+	int x = rect.x();
+
+	for (int y = 0; y < height; y++)
+	{
+		auto src = image.constScanLine(y);
+		auto dst = page.scanLine(rect.y() + y);
+
+		memcpy(dst + x * BPP, src, size_t(width) * BPP);
+
+		for (int e = 1; e <= mExtrude; e++)
+		{
+			memcpy(dst + (x - e) * BPP, src, BPP);
+			memcpy(dst + (x + width - 1 + e) * BPP,
+				src + (width - 1) * BPP, BPP);
+		}
+	}
+
+	// Extruded rows include extruded corners
+	size_t rowBytes = size_t(width + mExtrude * 2) * BPP;
+	int rowX = (x - mExtrude) * BPP;
+
+	for (int e = 1; e <= mExtrude; e++)
+	{
+		memcpy(page.scanLine(rect.y() - e) + rowX,
+			page.constScanLine(rect.y()) + rowX, rowBytes);
+		memcpy(page.scanLine(rect.bottom() + e) + rowX,
+			page.constScanLine(rect.bottom()) + rowX, rowBytes);
+	}
+}
@@ -0,0 +1,79 @@
+// Part of SWF to SAM animation converter
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QRect>
+#include <QSize>
+
+#include <vector>
+
+class QImage;
+
+// Packs images into power-of-two pages with skyline bottom-left
+// heuristic. Every image is surrounded by extruded edge pixels
+// and separated from its neighbours by padding.
+// Packing result depends only on input sizes and their order.
+class TextureAtlas
+{
+public:
+	struct Placement
+	{
+		int page;
+		QRect rect; // image pixels without extrusion
+	};
+
+	using Placements = std::vector<Placement>;
+	using Sizes = std::vector<QSize>;
+
+	TextureAtlas(int maxPageSize, int padding, int extrude);
+
+	static bool isPowerOfTwo(int value);
+
+	// Image with extrusion and padding is not larger than a page
+	bool fits(const QSize &size) const;
+
+	// All sizes should fit into a page
+	Placements pack(const Sizes &sizes);
+
+	inline const Sizes &pageSizes() const;
+
+	// Draws premultiplied RGBA8888 image to the page at placement rect
+	// and repeats its edge pixels into extrusion area
+	void draw(QImage &page, const QImage &image, const QRect &rect) const;
+
+private:
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	using Skyline = std::vector<Segment>;
+
+	struct Page
+	{
+		QSize size;
+		QSize used;
+		Skyline skyline;
+	};
+
+	void addPage(const QSize &size);
+	bool findPosition(
+		const Page &page, const QSize &cell, QPoint *pos, size_t *at) const;
+	void insert(Page &page, size_t at, const QPoint &pos, const QSize &cell);
+
+	std::vector<Page> mPages;
+	Sizes mPageSizes;
+	int mMaxPageSize;
+	int mPadding;
+	int mExtrude;
+};
+
+const TextureAtlas::Sizes &TextureAtlas::pageSizes() const
+{
+	return mPageSizes;
+}
@@ -7,8 +7,163 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QFile>
 
 #include "Converter.h"
+#include "BatchConverter.h"
+#include "ConverterDaemon.h"
+#include "ImageDeduplicator.h"
+#include "ImageEncoder.h"
+#include "Profiler.h"
+#include "SAMCompressor.h"
+
+static bool parseImageEncoderOptions(const QCommandLineParser &parser,
+	const QCommandLineOption &formatOption,
+	const QCommandLineOption &levelOption,
+	const QCommandLineOption &strategyOption,
+	const QCommandLineOption &filterOption, ImageEncoder *encoder)
+{
+	if (parser.isSet(formatOption))
+	{
+		ImageEncoder::Format format;
+
+		if (not ImageEncoder::parseFormat(
+				parser.value(formatOption), &format))
+		{
+			qCritical().noquote() << QString("Unknown image format '%1'.")
+										 .arg(parser.value(formatOption));
+			return false;
+		}
+
+		encoder->setFormat(format);
+	}
+
+	if (parser.isSet(levelOption))
+	{
+		int level;
+
+		if (not ImageEncoder::parseCompressionLevel(
+				parser.value(levelOption), &level))
+		{
+			qCritical().noquote()
+				<< QString("Bad compression level '%1'.")
+					   .arg(parser.value(levelOption));
+			return false;
+		}
+
+		encoder->setCompressionLevel(level);
+	}
+
+	if (parser.isSet(strategyOption))
+	{
+		ImageEncoder::Strategy strategy;
+
+		if (not ImageEncoder::parseStrategy(
+				parser.value(strategyOption), &strategy))
+		{
+			qCritical().noquote() << QString("Unknown PNG strategy '%1'.")
+										 .arg(parser.value(strategyOption));
+			return false;
+		}
+
+		encoder->setStrategy(strategy);
+	}
+
+	if (parser.isSet(filterOption))
+	{
+		ImageEncoder::Filter filter;
+
+		if (not ImageEncoder::parseFilter(
+				parser.value(filterOption), &filter))
+		{
+			qCritical().noquote() << QString("Unknown PNG filter '%1'.")
+										 .arg(parser.value(filterOption));
+			return false;
+		}
+
+		encoder->setFilter(filter);
+	}
+
+	return true;
+}
+
+static bool parseSamCompressorOptions(const QCommandLineParser &parser,
+	const QCommandLineOption &methodOption,
+	const QCommandLineOption &levelOption, SAMCompressor *compressor)
+{
+	if (parser.isSet(methodOption))
+	{
+		SAMCompressor::Method method;
+
+		if (not SAMCompressor::parseMethod(
+				parser.value(methodOption), &method))
+		{
+			qCritical().noquote()
+				<< QString("Unknown SAM compression method '%1'.")
+					   .arg(parser.value(methodOption));
+			return false;
+		}
+
+		compressor->setMethod(method);
+	}
+
+	if (parser.isSet(levelOption))
+	{
+		int level;
+
+		if (not SAMCompressor::parseCompressionLevel(
+				parser.value(levelOption), &level))
+		{
+			qCritical().noquote()
+				<< QString("Bad SAM compression level '%1'.")
+					   .arg(parser.value(levelOption));
+			return false;
+		}
+
+		compressor->setCompressionLevel(level);
+	}
+
+	return true;
+}
+
+static bool writeProfile(
+	const Profiler &profiler, const QString &format, const QString &filePath)
+{
+	Profiler::Format profileFormat;
+
+	if (not Profiler::parseFormat(format, &profileFormat))
+	{
+		qCritical().noquote()
+			<< QString("Unknown profile format '%1'.").arg(format);
+		return false;
+	}
+
+	QFile file;
+	bool ok;
+
+	if (filePath.isEmpty())
+	{
+		ok = file.open(stdout, QFile::WriteOnly);
+	} else
+	{
+		file.setFileName(filePath);
+		ok = file.open(QFile::WriteOnly | QFile::Truncate);
+	}
+
+	if (ok)
+	{
+		auto report = profiler.report(profileFormat);
+		ok = file.write(report) == report.size();
+	}
+
+	if (not ok)
+	{
+		qCritical().noquote()
+			<< QString("Unable to write profile '%1'.").arg(filePath);
+	}
+
+	return ok;
+}
 
 int main(int argc, char *argv[])
 {
@@ -34,12 +189,45 @@ int main(int argc, char *argv[])
 
 	QCommandLineOption samVesionOption(
 		QStringList("sam-version"),
-		"Output SAM-file format version (Default is 2).",
+		"Output SAM-file format version (Default is 2). Version 3 adds "
+		"keyframes and a frame seek index, version 4 also writes "
+		"compact varint move deltas.",
 		"value", "2");
 
+	QCommandLineOption keyframeIntervalOption(
+		QStringList("keyframe-interval"),
+		"Frames between SAM version 3 keyframes, 0 to write the first "
+		"frame only (Default is 30).",
+		"value", QString::number(Converter::DEFAULT_KEYFRAME_INTERVAL));
+
+	QCommandLineOption matrixPrecisionOption(
+		QStringList("matrix-precision"),
+		"Fraction bits of SAM version 4 object matrices from 0 to 16 "
+		"(Default is 16, lossless).",
+		"bits", QString::number(Converter::DEFAULT_MATRIX_PRECISION));
+
+	QCommandLineOption samCompressionOption(
+		QStringList("sam-compression"),
+		"Wrap SAM-file into a compressed envelope of independently "
+		"compressed blocks: none, zlib or zstd (if built with zstd). "
+		"Default is none.",
+		"method");
+
+	QCommandLineOption samCompressionLevelOption(
+		QStringList("sam-compression-level"),
+		"SAM-file compression level, 0 to 9 for zlib or 1 to 22 for zstd, "
+		"-1 is the default one.",
+		"value");
+
 	QCommandLineOption scaleOption(
 		{"s", "scale"}, "Output scale factor.", "value", "1");
 
+	QCommandLineOption scalesOption(QStringList("scales"),
+		"Comma separated output scale factors. SWF-file is parsed once "
+		"and one SAM-file is written per scale with '@<scale>x' name "
+		"suffix. Overrides --scale.",
+		"list");
+
 	QCommandLineOption configOption(
 		{"c", "config"},
 		"Converter configuration JSON-file.\n"
@@ -49,20 +237,153 @@ int main(int argc, char *argv[])
 		"     \"<label_name>\": [\n"
 		"       \"<old_name1>\", ..., \"<old_nameN>\"\n"
 		"     ]\n"
-		"   }\n"
+		"   },\n"
+		"   \"image_format\": \"png|raw|lz4\",\n"
+		"   \"png_compression\": <-1..9>,\n"
+		"   \"png_strategy\": \"<strategy>\",\n"
+		"   \"png_filter\": \"<filter>\",\n"
+		"   \"resample_filter\": \"qt|box|bilinear|lanczos\",\n"
+		"   \"sam_compression\": \"none|zlib|zstd\",\n"
+		"   \"sam_compression_level\": <-1..22>\n"
 		"} ",
 		"json");
 
+	QCommandLineOption imageFormatOption(QStringList("image-format"),
+		"Output image format: png, raw (RGBA8888 premultiplied pixels "
+		"with a small header) or lz4 (LZ4-framed raw, if built with LZ4). "
+		"Default is png.",
+		"format");
+
+	QCommandLineOption compressionOption(QStringList("compression"),
+		"PNG zlib (or LZ4) compression level from 0 to 9, "
+		"-1 is the default one.",
+		"value");
+
+	QCommandLineOption pngStrategyOption(QStringList("png-strategy"),
+		"PNG zlib strategy: default, filtered, huffman, rle or fixed.",
+		"strategy");
+
+	QCommandLineOption pngFilterOption(QStringList("png-filter"),
+		"PNG row filter: none, sub, up, average, paeth or adaptive "
+		"(picks the best filter for every row).",
+		"filter");
+
+	QCommandLineOption resampleFilterOption(QStringList("resample-filter"),
+		"Image scaling filter: qt (QImage smooth scaling), box "
+		"(pixel area average), bilinear or lanczos. Default is qt.",
+		"filter");
+
+	QCommandLineOption atlasOption(QStringList("atlas"),
+		"Pack all images into power-of-two texture atlas pages "
+		"(SAM version 2 or later).");
+
+	QCommandLineOption atlasSizeOption(QStringList("atlas-size"),
+		"Maximal atlas page size, power of two (Default is 2048).", "value",
+		QString::number(Converter::DEFAULT_ATLAS_PAGE_SIZE));
+
+	QCommandLineOption atlasPaddingOption(QStringList("atlas-padding"),
+		"Transparent pixels between atlas images (Default is 2).", "value",
+		QString::number(Converter::DEFAULT_ATLAS_PADDING));
+
+	QCommandLineOption atlasExtrudeOption(QStringList("atlas-extrude"),
+		"Number of times atlas image edge pixels are repeated "
+		"around it (Default is 1).",
+		"value", QString::number(Converter::DEFAULT_ATLAS_EXTRUDE));
+
+	QCommandLineOption batchOption(
+		{"b", "batch"},
+		"Batch input: directory (searched recursively), wildcard pattern or "
+		"manifest file with one SWF-file path per line. "
+		"Can be specified multiple times.",
+		"path");
+
+	QCommandLineOption jobsOption(
+		{"j", "jobs"},
+		"Number of parallel batch or daemon conversions "
+		"(Default is CPU core count).",
+		"value", "0");
+
+	QCommandLineOption daemonOption(QStringList("daemon"),
+		"Run as a daemon serving conversion jobs on the local socket. "
+		"Each job is a single line JSON object {\"id\", \"input\", "
+		"\"output\", \"scale\", \"scales\", \"sam_version\", "
+		"\"skip_unsupported\", \"streaming\", \"config\", \"config_file\"}, "
+		"{\"command\": \"quit\"} stops the daemon. Other options "
+		"are defaults for the jobs.",
+		"name");
+
 	QCommandLineOption skipUnsupportedOption(
 		QStringList("skip-unsupported"),
 		"Do not fail with error on unsupported SWF elements.");
 
+	QCommandLineOption streamingOption(
+		QStringList("streaming"),
+		"Convert in a single pass releasing each SWF tag as soon as "
+		"it is processed. Keeps memory usage low for huge SWF-files.");
+
+	QCommandLineOption imageCacheOption(
+		QStringList("image-cache"),
+		"Directory to keep exported images between runs. "
+		"Unchanged images are linked from there instead of "
+		"being encoded again.",
+		"path");
+
+	QCommandLineOption dedupImagesOption(
+		QStringList("dedup-images"),
+		"Export images with identical pixels only once. In batch mode "
+		"equal images of different SWF-files are linked to each other.");
+
+	QCommandLineOption incrementalOption(QStringList("incremental"),
+		"Skip SWF-files converted before with the same options. "
+		"Writes a manifest next to each SAM-file.");
+
+	QCommandLineOption incrementalMtimeOption(
+		QStringList("incremental-mtime"),
+		"Same as --incremental, but unchanged file size and modification "
+		"time are enough to skip without hashing the input.");
+
+	QCommandLineOption profileOption(QStringList("profile"),
+		"Measure time and data size of every conversion stage.");
+
+	QCommandLineOption profileFormatOption(QStringList("profile-format"),
+		"Profile report format: table, json or trace "
+		"(Chrome trace event format). Default is table.",
+		"format", "table");
+
+	QCommandLineOption profileOutputOption(QStringList("profile-output"),
+		"Profile report file path (Default is standard output).", "path");
+
 	parser.addOption(inputOption);
 	parser.addOption(outputOption);
 	parser.addOption(samVesionOption);
+	parser.addOption(keyframeIntervalOption);
+	parser.addOption(matrixPrecisionOption);
+	parser.addOption(samCompressionOption);
+	parser.addOption(samCompressionLevelOption);
 	parser.addOption(scaleOption);
+	parser.addOption(scalesOption);
 	parser.addOption(skipUnsupportedOption);
+	parser.addOption(streamingOption);
+	parser.addOption(imageCacheOption);
+	parser.addOption(dedupImagesOption);
+	parser.addOption(imageFormatOption);
+	parser.addOption(compressionOption);
+	parser.addOption(pngStrategyOption);
+	parser.addOption(pngFilterOption);
+	parser.addOption(resampleFilterOption);
+	parser.addOption(atlasOption);
+	parser.addOption(atlasSizeOption);
+	parser.addOption(atlasPaddingOption);
+	parser.addOption(atlasExtrudeOption);
 	parser.addOption(configOption);
+	parser.addOption(batchOption);
+	parser.addOption(jobsOption);
+	parser.addOption(daemonOption);
+	parser.addOption(incrementalOption);
+	parser.addOption(incrementalMtimeOption);
+	parser.addOption(profileOption);
+	parser.addOption(profileFormatOption);
+	parser.addOption(profileOutputOption);
 
 	parser.process(a);
 
@@ -71,16 +392,144 @@ int main(int argc, char *argv[])
 	cvt.setInputFilePath(parser.value(inputOption));
 	cvt.setOutputDirPath(parser.value(outputOption));
 	cvt.setSamVersion(parser.value(samVesionOption).toInt());
+	cvt.setKeyframeInterval(parser.value(keyframeIntervalOption).toInt());
+	cvt.setMatrixPrecision(parser.value(matrixPrecisionOption).toInt());
 	cvt.setScale(parser.value(scaleOption).toDouble());
+
+	if (parser.isSet(scalesOption))
+	{
+		Converter::Scales scales;
+
+		for (auto &value : parser.value(scalesOption).split(','))
+		{
+			scales.push_back(value.trimmed().toDouble());
+		}
+
+		cvt.setScales(scales);
+	}
+
 	cvt.setSkipUnsupported(parser.isSet(skipUnsupportedOption));
+	cvt.setStreaming(parser.isSet(streamingOption));
+	cvt.setImageCacheDirPath(parser.value(imageCacheOption));
+	cvt.setIncremental(
+		parser.isSet(incrementalOption) || parser.isSet(incrementalMtimeOption),
+		parser.isSet(incrementalMtimeOption));
+	cvt.setAtlas(parser.isSet(atlasOption));
+	cvt.setAtlasPageSize(parser.value(atlasSizeOption).toInt());
+	cvt.setAtlasPadding(parser.value(atlasPaddingOption).toInt());
+	cvt.setAtlasExtrude(parser.value(atlasExtrudeOption).toInt());
+
+	if (parser.isSet(dedupImagesOption))
+	{
+		cvt.setImageDeduplicator(std::make_shared<ImageDeduplicator>());
+	}
+
+	std::shared_ptr<Profiler> profiler;
+
+	if (parser.isSet(profileOption))
+	{
+		profiler = std::make_shared<Profiler>();
+		cvt.setProfiler(profiler);
+	}
+
 	cvt.loadConfig(parser.value(configOption));
 
-	int result = cvt.exec();
+	// Command line options override configuration file ones
+	auto encoder = cvt.imageEncoder();
+
+	if (not parseImageEncoderOptions(parser, imageFormatOption,
+			compressionOption, pngStrategyOption, pngFilterOption, &encoder))
+	{
+		return Converter::CONFIG_PARSE_ERROR;
+	}
+
+	cvt.setImageEncoder(encoder);
+
+	auto compressor = cvt.samCompressor();
+
+	if (not parseSamCompressorOptions(parser, samCompressionOption,
+			samCompressionLevelOption, &compressor))
+	{
+		return Converter::CONFIG_PARSE_ERROR;
+	}
+
+	cvt.setSamCompressor(compressor);
+
+	if (parser.isSet(resampleFilterOption))
+	{
+		auto resampler = cvt.imageResampler();
+		ImageResampler::Filter filter;
+
+		if (not ImageResampler::parseFilter(
+				parser.value(resampleFilterOption), &filter))
+		{
+			qCritical().noquote()
+				<< QString("Unknown resample filter '%1'.")
+					   .arg(parser.value(resampleFilterOption));
+			return Converter::CONFIG_PARSE_ERROR;
+		}
+
+		resampler.setFilter(filter);
+		cvt.setImageResampler(resampler);
+	}
+
+	int result;
+
+	if (parser.isSet(daemonOption))
+	{
+		ConverterDaemon daemon;
+		daemon.setConverter(cvt);
+		daemon.setThreadCount(parser.value(jobsOption).toInt());
+
+		if (not daemon.listen(parser.value(daemonOption)))
+		{
+			qCritical().noquote() << daemon.errorMessage();
+			return 1;
+		}
+
+		result = a.exec();
+	} else if (parser.isSet(batchOption))
+	{
+		BatchConverter batch;
+		batch.setConverter(cvt);
+		batch.setOutputDirPath(parser.value(outputOption));
+		batch.setThreadCount(parser.value(jobsOption).toInt());
+
+		auto inputs = parser.values(batchOption);
+
+		if (parser.isSet(inputOption))
+			inputs.prepend(parser.value(inputOption));
+
+		for (auto &input : inputs)
+		{
+			if (not batch.addInput(input))
+				break;
+		}
+
+		result = batch.exec();
+
+		if (not batch.items().empty())
+			qInfo().noquote() << batch.summary();
+
+		auto errorMessage = batch.errorMessage();
+
+		if (not errorMessage.isEmpty())
+			qCritical().noquote() << errorMessage;
+	} else
+	{
+		result = cvt.exec();
+
+		auto errorMessage = cvt.errorMessage();
 
-	auto errorMessage = cvt.errorMessage();
+		if (not errorMessage.isEmpty())
+			qCritical().noquote() << errorMessage;
+	}
 
-	if (not errorMessage.isEmpty())
-		qCritical().noquote() << errorMessage;
+	if (profiler)
+	{
+		writeProfile(*profiler, parser.value(profileFormatOption),
+			parser.value(profileOutputOption));
+	}
 
 	return result;
 }
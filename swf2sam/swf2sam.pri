@@ -0,0 +1,84 @@
+# SWF to SAM converter sources shared by swf2sam and its benchmark
+# Uses Qt Framework from www.qt.io
+# Uses libraries from www.github.com/matthiaskramm/swftools
+
+SWF2SAM_VERSION = 2.0.7
+
+QT += core gui concurrent network
+
+CONFIG += c++11
+
+INCLUDEPATH += $$PWD
+
+# Converter version is stored to build manifests
+DEFINES += "SWF2SAM_VERSION=\"\\\"$$SWF2SAM_VERSION\\\"\""
+
+SOURCES += \
+    $$PWD/Converter.cpp \
+    $$PWD/ConverterDaemon.cpp \
+    $$PWD/ConverterSink.cpp \
+    $$PWD/QIODeviceSWFReader.cpp \
+    $$PWD/BatchConverter.cpp \
+    $$PWD/BinaryWriter.cpp \
+    $$PWD/BuildManifest.cpp \
+    $$PWD/MappedSWFReader.cpp \
+    $$PWD/MemoryArena.cpp \
+    $$PWD/StreamSWFReader.cpp \
+    $$PWD/PixelConversion.cpp \
+    $$PWD/ImageCache.cpp \
+    $$PWD/ImageEncoder.cpp \
+    $$PWD/ImageResampler.cpp \
+    $$PWD/ImageDeduplicator.cpp \
+    $$PWD/JpegDecoder.cpp \
+    $$PWD/Profiler.cpp \
+    $$PWD/SAMCompressor.cpp \
+    $$PWD/SegmentedDevice.cpp \
+    $$PWD/TextureAtlas.cpp
+
+HEADERS += \
+    $$PWD/Converter.h \
+    $$PWD/ConverterDaemon.h \
+    $$PWD/ConverterSink.h \
+    $$PWD/QIODeviceSWFReader.h \
+    $$PWD/BatchConverter.h \
+    $$PWD/BinaryWriter.h \
+    $$PWD/BuildManifest.h \
+    $$PWD/MappedSWFReader.h \
+    $$PWD/MemoryArena.h \
+    $$PWD/StreamSWFReader.h \
+    $$PWD/PixelConversion.h \
+    $$PWD/ImageCache.h \
+    $$PWD/ImageEncoder.h \
+    $$PWD/ImageResampler.h \
+    $$PWD/ImageDeduplicator.h \
+    $$PWD/JpegDecoder.h \
+    $$PWD/Profiler.h \
+    $$PWD/SAMCompressor.h \
+    $$PWD/SegmentedDevice.h \
+    $$PWD/TextureAtlas.h
+
+# Configure with CONFIG+=swf2sam_lz4 to enable LZ4-framed raw images
+swf2sam_lz4 {
+    DEFINES += HAVE_LZ4
+    LIBS += -llz4
+}
+
+# Configure with CONFIG+=swf2sam_libjpeg to decode JPEG with libjpeg-turbo
+# and downscale in DCT domain
+swf2sam_libjpeg {
+    DEFINES += SWF2SAM_LIBJPEG
+    LIBS += -ljpeg
+}
+
+# Configure with CONFIG+=swf2sam_zstd to enable zstd-compressed SAM-files
+swf2sam_zstd {
+    DEFINES += HAVE_ZSTD
+    LIBS += -lzstd
+}
+
+win32 {
+    LIBS += -lAdvapi32
+    DEFINES += "or=\"||\""
+    DEFINES += "and=\"&&\""
+    DEFINES += "not=\"!\""
+}
@@ -2,16 +2,16 @@
 # Uses Qt Framework from www.qt.io
 # Uses libraries from www.github.com/matthiaskramm/swftools
 
-VERSION = 2.0.7
+include(../libs/swflibs_dep.pri)
+
+include(swf2sam.pri)
+
+VERSION = $$SWF2SAM_VERSION
 
 QMAKE_TARGET_PRODUCT = swf2sam
 QMAKE_TARGET_DESCRIPTION = SWF to SAM animation converter
 QMAKE_TARGET_COPYRIGHT = Copyright (c) 2017 Alexandra Cherdantseva
 
-QT += core gui
-
-CONFIG += c++11
-
 TARGET = swf2sam
 CONFIG += console
 
@@ -21,19 +21,4 @@ DEFINES += "APP_DESCRIPTION=\"\\\"$$QMAKE_TARGET_DESCRIPTION\\\"\""
 
 TEMPLATE = app
 
-include(../libs/swflibs_dep.pri)
-
-SOURCES += main.cpp \
-    Converter.cpp \
-    QIODeviceSWFReader.cpp
-
-HEADERS += \
-    Converter.h \
-    QIODeviceSWFReader.h
-
-win32 {
-    LIBS += -lAdvapi32
-    DEFINES += "or=\"||\""
-    DEFINES += "and=\"&&\""
-    DEFINES += "not=\"!\""
-}
+SOURCES += main.cpp
@@ -0,0 +1,296 @@
+// Part of SWF to SAM animation converter benchmark
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "SWFGenerator.h"
+
+#include "rfxswf.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+
+#include <zlib.h>
+
+#include <vector>
+
+enum
+{
+	TWIPS_PER_PIXEL = 20,
+	STAGE_WIDTH = 1024,
+	STAGE_HEIGHT = 768,
+	REPLACE_INTERVAL = 50,
+	REPLACE_DIVIDER = 10,
+	BITMAP_FORMAT_32BIT = 5,
+	JPEG_QUALITY = 90
+};
+
+// Small deterministic generator, so the corpus does not depend
+// on the standard library implementation
+class Random
+{
+public:
+	explicit Random(quint32 seed)
+		: mState(seed ? seed : 1)
+	{
+	}
+
+	quint32 next()
+	{
+		mState ^= mState << 13;
+		mState ^= mState >> 17;
+		mState ^= mState << 5;
+		return mState;
+	}
+
+	int range(int min, int max)
+	{
+		return min + int(next() % quint32(max - min + 1));
+	}
+
+private:
+	quint32 mState;
+};
+
+SWFGenerator::Params::Params()
+	: frameCount(1)
+	, depthCount(1)
+	, shapeCount(1)
+	, imageWidth(64)
+	, imageHeight(64)
+	, jpeg(false)
+	, compressed(false)
+	, seed(1)
+{
+}
+
+qint64 SWFGenerator::Params::pixelCount() const
+{
+	return qint64(imageWidth) * imageHeight * shapeCount;
+}
+
+static QImage makeImage(int width, int height, Random &random)
+{
+	QImage image(width, height, QImage::Format_ARGB32);
+
+	int r0 = random.range(0, 255);
+	int g0 = random.range(0, 255);
+	int b0 = random.range(0, 255);
+
+	for (int y = 0; y < height; y++)
+	{
+		auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
+
+		for (int x = 0; x < width; x++)
+		{
+			int noise = random.range(0, 31);
+			int a = 255 - ((x + y) * 128) / (width + height);
+
+			line[x] = qRgba((r0 + x + noise) & 0xFF, (g0 + y + noise) & 0xFF,
+				(b0 + x + y) & 0xFF, a);
+		}
+	}
+
+	return image;
+}
+
+static bool setLosslessBits(TAG *tag, const QImage &image)
+{
+	int width = image.width();
+	int height = image.height();
+
+	swf_SetU8(tag, BITMAP_FORMAT_32BIT);
+	swf_SetU16(tag, U16(width));
+	swf_SetU16(tag, U16(height));
+
+	// Premultiplied ARGB byte order
+	std::vector<Bytef> argb(size_t(width) * height * 4);
+	auto dst = argb.data();
+
+	for (int y = 0; y < height; y++)
+	{
+		auto line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+
+		for (int x = 0; x < width; x++)
+		{
+			QRgb p = qPremultiply(line[x]);
+			*dst++ = Bytef(qAlpha(p));
+			*dst++ = Bytef(qRed(p));
+			*dst++ = Bytef(qGreen(p));
+			*dst++ = Bytef(qBlue(p));
+		}
+	}
+
+	auto compressedSize = compressBound(uLong(argb.size()));
+	std::vector<Bytef> compressed(compressedSize);
+
+	if (Z_OK !=
+		compress2(compressed.data(), &compressedSize, argb.data(),
+			uLong(argb.size()), Z_DEFAULT_COMPRESSION))
+	{
+		return false;
+	}
+
+	swf_SetBlock(tag, compressed.data(), int(compressedSize));
+	return true;
+}
+
+static bool setJpegBits(TAG *tag, const QImage &image)
+{
+	QByteArray jpeg;
+	QBuffer buffer(&jpeg);
+	buffer.open(QBuffer::WriteOnly);
+
+	if (not image.convertToFormat(QImage::Format_RGB32)
+				.save(&buffer, "jpg", JPEG_QUALITY))
+	{
+		return false;
+	}
+
+	swf_SetBlock(
+		tag, reinterpret_cast<const U8 *>(jpeg.constData()), jpeg.size());
+	return true;
+}
+
+static void setBitmapShape(TAG *tag, U16 shapeId, U16 imageId, int width,
+	int height)
+{
+	SHAPE *shape;
+	swf_ShapeNew(&shape);
+
+	MATRIX m;
+	swf_GetMatrix(nullptr, &m);
+	m.sx = TWIPS_PER_PIXEL * 0x10000;
+	m.sy = TWIPS_PER_PIXEL * 0x10000;
+
+	int fillStyle = swf_ShapeAddBitmapFillStyle(shape, &m, imageId, 0);
+
+	SRECT r;
+	r.xmin = 0;
+	r.ymin = 0;
+	r.xmax = width * TWIPS_PER_PIXEL;
+	r.ymax = height * TWIPS_PER_PIXEL;
+
+	swf_SetU16(tag, shapeId);
+	swf_SetRect(tag, &r);
+	swf_SetShapeHeader(tag, shape);
+	swf_ShapeSetAll(tag, shape, 0, 0, 0, fillStyle, 0);
+	swf_ShapeSetLine(tag, shape, r.xmax, 0);
+	swf_ShapeSetLine(tag, shape, 0, r.ymax);
+	swf_ShapeSetLine(tag, shape, -r.xmax, 0);
+	swf_ShapeSetLine(tag, shape, 0, -r.ymax);
+	swf_ShapeSetEnd(tag);
+
+	swf_ShapeFree(shape);
+}
+
+static void objectMatrix(MATRIX *m, int depth, int frame, Random &random)
+{
+	swf_GetMatrix(nullptr, m);
+
+	int x = (depth * 37 + frame * 3) % STAGE_WIDTH;
+	int y = (depth * 53 + frame * 2) % STAGE_HEIGHT;
+
+	m->tx = x * TWIPS_PER_PIXEL + random.range(-10, 10);
+	m->ty = y * TWIPS_PER_PIXEL + random.range(-10, 10);
+
+	if (depth % 7 == 0)
+	{
+		m->r0 = random.range(-0x4000, 0x4000);
+		m->r1 = -m->r0;
+		m->sx = 0x10000 - random.range(0, 0x2000);
+		m->sy = m->sx;
+	}
+}
+
+bool SWFGenerator::generate(const Params &params, const QString &filePath)
+{
+	Q_ASSERT(params.frameCount > 0);
+	Q_ASSERT(params.shapeCount > 0);
+	Q_ASSERT(params.depthCount > 0);
+
+	Random random(params.seed);
+
+	SWF swf;
+	memset(&swf, 0, sizeof(SWF));
+	swf.fileVersion = 8;
+	swf.compressed = params.compressed ? 1 : 0;
+	swf.frameRate = 24 << 8;
+	swf.frameCount = U16(params.frameCount);
+	swf.movieSize.xmax = STAGE_WIDTH * TWIPS_PER_PIXEL;
+	swf.movieSize.ymax = STAGE_HEIGHT * TWIPS_PER_PIXEL;
+
+	TAG *tag = swf_InsertTag(nullptr, ST_SETBACKGROUNDCOLOR);
+	swf.firstTag = tag;
+	swf_SetU8(tag, 0xFF);
+	swf_SetU8(tag, 0xFF);
+	swf_SetU8(tag, 0xFF);
+
+	bool ok = true;
+
+	for (int i = 0; i < params.shapeCount && ok; i++)
+	{
+		auto image = makeImage(params.imageWidth, params.imageHeight, random);
+
+		U16 imageId = U16(1 + i);
+		tag = swf_InsertTag(tag,
+			params.jpeg ? ST_DEFINEBITSJPEG2 : ST_DEFINEBITSLOSSLESS2);
+		swf_SetU16(tag, imageId);
+
+		ok = params.jpeg ? setJpegBits(tag, image)
+						 : setLosslessBits(tag, image);
+
+		tag = swf_InsertTag(tag, ST_DEFINESHAPE);
+		setBitmapShape(tag, U16(1 + params.shapeCount + i), imageId,
+			params.imageWidth, params.imageHeight);
+	}
+
+	for (int frame = 0; frame < params.frameCount && ok; frame++)
+	{
+		for (int depth = 1; depth <= params.depthCount; depth++)
+		{
+			MATRIX m;
+			objectMatrix(&m, depth, frame, random);
+
+			bool replace = frame > 0 && frame % REPLACE_INTERVAL == 0 &&
+				depth % REPLACE_DIVIDER == frame % REPLACE_DIVIDER;
+
+			if (replace)
+			{
+				tag = swf_InsertTag(tag, ST_REMOVEOBJECT2);
+				swf_SetU16(tag, U16(depth));
+			}
+
+			if (frame == 0 || replace)
+			{
+				int shapeIndex = random.range(0, params.shapeCount - 1);
+
+				tag = swf_InsertTag(tag, ST_PLACEOBJECT2);
+				swf_ObjectPlace(tag, U16(1 + params.shapeCount + shapeIndex),
+					U16(depth), &m, nullptr, nullptr);
+			} else
+			{
+				tag = swf_InsertTag(tag, ST_PLACEOBJECT2);
+				swf_ObjectMove(tag, U16(depth), &m, nullptr);
+			}
+		}
+
+		tag = swf_InsertTag(tag, ST_SHOWFRAME);
+	}
+
+	tag = swf_InsertTag(tag, ST_END);
+
+	if (ok)
+	{
+		QFile file(filePath);
+
+		ok = file.open(QFile::WriteOnly | QFile::Truncate) &&
+			swf_WriteSWF(file.handle(), &swf) >= 0;
+	}
+
+	swf_FreeTags(&swf);
+
+	return ok;
+}
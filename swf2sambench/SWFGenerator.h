@@ -0,0 +1,36 @@
+// Part of SWF to SAM animation converter benchmark
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QString>
+
+// Generates deterministic synthetic SWF-files:
+// every shape is a bitmap filled rectangle with its own image,
+// every depth is placed at the first frame and moved at every frame,
+// some depths are replaced periodically.
+class SWFGenerator
+{
+public:
+	struct Params
+	{
+		QString name;
+		int frameCount;
+		int depthCount;
+		int shapeCount;
+		int imageWidth;
+		int imageHeight;
+		bool jpeg;
+		bool compressed;
+		quint32 seed;
+
+		Params();
+
+		qint64 pixelCount() const;
+	};
+
+	static bool generate(const Params &params, const QString &filePath);
+};
@@ -0,0 +1,606 @@
+// Part of SWF to SAM animation converter benchmark
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include "Converter.h"
+#include "ImageResampler.h"
+#include "PixelConversion.h"
+#include "Profiler.h"
+#include "SWFGenerator.h"
+
+#include <vector>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Peak memory is process-wide, so every scenario is converted
+// in its own process
+static qint64 peakMemoryUsage()
+{
+#ifdef Q_OS_WIN
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return qint64(counters.PeakWorkingSetSize);
+
+	return 0;
+#else
+	struct rusage usage;
+
+	if (0 != getrusage(RUSAGE_SELF, &usage))
+		return 0;
+
+#ifdef Q_OS_MACOS
+	return qint64(usage.ru_maxrss);
+#else
+	return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static std::vector<SWFGenerator::Params> scenarios()
+{
+	std::vector<SWFGenerator::Params> result;
+	SWFGenerator::Params params;
+
+	params.name = "long_timeline";
+	params.frameCount = 10000;
+	params.depthCount = 20;
+	params.shapeCount = 8;
+	params.imageWidth = 32;
+	params.imageHeight = 32;
+	params.seed = 1;
+	result.push_back(params);
+
+	params.name = "many_depths";
+	params.frameCount = 200;
+	params.depthCount = 2000;
+	params.shapeCount = 16;
+	params.seed = 2;
+	result.push_back(params);
+
+	params.name = "large_images";
+	params.frameCount = 24;
+	params.depthCount = 4;
+	params.shapeCount = 4;
+	params.imageWidth = 2048;
+	params.imageHeight = 2048;
+	params.seed = 3;
+	result.push_back(params);
+
+	params.name = "many_images";
+	params.frameCount = 24;
+	params.depthCount = 100;
+	params.shapeCount = 1000;
+	params.imageWidth = 64;
+	params.imageHeight = 64;
+	params.seed = 4;
+	result.push_back(params);
+
+	params.name = "many_jpegs";
+	params.jpeg = true;
+	params.compressed = true;
+	params.seed = 5;
+	result.push_back(params);
+
+	return result;
+}
+
+// Makes sure vectorized pixel kernels still match the scalar reference,
+// otherwise timings are meaningless
+static bool checkPixelConversion()
+{
+	enum
+	{
+		MAX_PIXELS = 100
+	};
+
+	std::vector<quint8> src(MAX_PIXELS * 4);
+	std::vector<quint8> alpha(MAX_PIXELS);
+
+	for (size_t i = 0; i < src.size(); i++)
+		src[i] = quint8(i * 7 + 3);
+
+	for (size_t i = 0; i < alpha.size(); i++)
+		alpha[i] = quint8(i * 13 + 1);
+
+	for (int n = 0; n < MAX_PIXELS; n++)
+	{
+		for (bool withAlpha : {false, true})
+		{
+			std::vector<quint8> vectorized(MAX_PIXELS * 4, 0);
+			std::vector<quint8> scalar(MAX_PIXELS * 4, 0);
+
+			PixelConversion::argbToRgba(
+				src.data(), vectorized.data(), n, withAlpha);
+			PixelConversion::argbToRgbaScalar(
+				src.data(), scalar.data(), n, withAlpha);
+
+			if (vectorized != scalar)
+				return false;
+
+			PixelConversion::mergeAlpha(vectorized.data(), alpha.data(), n);
+			PixelConversion::mergeAlphaScalar(scalar.data(), alpha.data(), n);
+
+			if (vectorized != scalar)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool checkImageResampler()
+{
+	QImage image(37, 23, QImage::Format_RGBA8888_Premultiplied);
+
+	for (int y = 0; y < image.height(); y++)
+	{
+		auto line = image.scanLine(y);
+
+		for (int x = 0; x < image.width(); x++)
+		{
+			quint8 alpha = quint8(x * 11 + y * 5);
+			*line++ = quint8((x * 7 + y * 3) % (alpha + 1));
+			*line++ = quint8((x * 3 + y * 13) % (alpha + 1));
+			*line++ = quint8((x + y) % (alpha + 1));
+			*line++ = alpha;
+		}
+	}
+
+	ImageResampler resampler;
+
+	for (auto filter : {ImageResampler::FILTER_BOX,
+			 ImageResampler::FILTER_BILINEAR, ImageResampler::FILTER_LANCZOS})
+	{
+		resampler.setFilter(filter);
+
+		for (auto &size : {QSize(11, 7), QSize(37, 9), QSize(80, 50)})
+		{
+			if (resampler.scaled(image, size.width(), size.height()) !=
+				resampler.scaledScalar(image, size.width(), size.height()))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+enum
+{
+	EXIT_ERROR = 1,
+	EXIT_REGRESSION = 2
+};
+
+struct RunOptions
+{
+	QString workDirPath;
+	ImageResampler resampler;
+	Profiler::Format profileFormat;
+	QString profileFormatName;
+	qreal scale;
+	int samVersion;
+	int iterations;
+	bool streaming;
+};
+
+static QString resultFilePath(const QString &workDirPath, const QString &name)
+{
+	return QDir(workDirPath).filePath(name + ".result.json");
+}
+
+// Converts a generated scenario SWF-file, prints timings and stage
+// report and saves measurements for the parent process
+static bool convertScenario(
+	const RunOptions &options, const QString &name, QFile &out)
+{
+	QDir workDir(options.workDirPath);
+	auto swfFilePath = workDir.filePath(name + ".swf");
+	auto profiler = std::make_shared<Profiler>();
+
+	qint64 bestMs = -1;
+	qint64 totalMs = 0;
+
+	for (int i = 0; i < options.iterations; i++)
+	{
+		Converter cvt;
+		cvt.setInputFilePath(swfFilePath);
+		cvt.setOutputDirPath(workDir.filePath(name));
+		cvt.setSamVersion(options.samVersion);
+		cvt.setStreaming(options.streaming);
+		cvt.setScale(options.scale);
+		cvt.setImageResampler(options.resampler);
+		cvt.setProfiler(profiler);
+
+		QElapsedTimer timer;
+		timer.start();
+		int cvtResult = cvt.exec();
+		auto ms = timer.elapsed();
+
+		if (cvtResult != Converter::OK)
+		{
+			qCritical().noquote() << cvt.errorMessage();
+			return false;
+		}
+
+		totalMs += ms;
+
+		if (bestMs < 0 || ms < bestMs)
+			bestMs = ms;
+	}
+
+	qint64 peakKiB = peakMemoryUsage() / 1024;
+
+	out.write(QString("Converter::exec best %1 ms, average %2 ms (%3 runs), "
+					  "%4 pixel kernels, peak memory %5 KiB\n")
+				  .arg(bestMs)
+				  .arg(totalMs / options.iterations)
+				  .arg(options.iterations)
+				  .arg(PixelConversion::instructionSet())
+				  .arg(peakKiB)
+				  .toUtf8());
+
+	out.write(profiler->report(options.profileFormat));
+	out.write("\n");
+	out.flush();
+
+	QJsonObject result;
+	result.insert("best_ms", bestMs);
+	result.insert("average_ms", totalMs / options.iterations);
+	result.insert("peak_memory_kib", peakKiB);
+
+	QFile resultFile(resultFilePath(options.workDirPath, name));
+
+	return resultFile.open(QFile::WriteOnly | QFile::Truncate) &&
+		resultFile.write(QJsonDocument(result).toJson()) >= 0;
+}
+
+static bool runScenarioProcess(const RunOptions &options, const QString &name,
+	QJsonObject *result)
+{
+	QFile::remove(resultFilePath(options.workDirPath, name));
+
+	QStringList args;
+	args << "--run-scenario" << name;
+	args << "--output_dir" << options.workDirPath;
+	args << "--iterations" << QString::number(options.iterations);
+	args << "--sam-version" << QString::number(options.samVersion);
+	args << "--scale" << QString::number(options.scale, 'g', 17);
+	args << "--resample-filter"
+		 << ImageResampler::filterName(options.resampler.filter());
+	args << "--profile-format" << options.profileFormatName;
+
+	if (options.streaming)
+		args << "--streaming";
+
+	QProcess process;
+	process.setProcessChannelMode(QProcess::ForwardedChannels);
+	process.start(QCoreApplication::applicationFilePath(), args);
+
+	if (not process.waitForFinished(-1) ||
+		process.exitStatus() != QProcess::NormalExit ||
+		process.exitCode() != 0)
+	{
+		return false;
+	}
+
+	QFile resultFile(resultFilePath(options.workDirPath, name));
+
+	if (not resultFile.open(QFile::ReadOnly))
+		return false;
+
+	auto doc = QJsonDocument::fromJson(resultFile.readAll());
+
+	if (not doc.isObject())
+		return false;
+
+	*result = doc.object();
+	return true;
+}
+
+// Reports metrics exceeding baseline values by more than tolerance
+static bool compareWithBaseline(const QString &name,
+	const QJsonObject &result, const QJsonObject &baseline, qreal tolerance)
+{
+	bool ok = true;
+
+	for (auto metric : {"best_ms", "peak_memory_kib"})
+	{
+		auto key = QLatin1String(metric);
+		double base = baseline.value(key).toDouble();
+		double value = result.value(key).toDouble();
+
+		if (base <= 0.0 || value <= base * (1.0 + tolerance / 100.0))
+			continue;
+
+		qCritical().noquote()
+			<< QString("Regression in %1: %2 is %3, baseline is %4.")
+				   .arg(name, key)
+				   .arg(value)
+				   .arg(base);
+		ok = false;
+	}
+
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication::setApplicationVersion(APP_VERSION);
+	QCoreApplication::setApplicationName(APP_NAME);
+
+	QCoreApplication a(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(APP_DESCRIPTION);
+	parser.addVersionOption();
+	parser.addHelpOption();
+
+	QCommandLineOption outputOption({"o", "output_dir"},
+		"Directory to keep generated SWF-files and conversion results "
+		"(Default is a temporary directory).",
+		"path");
+
+	QCommandLineOption scenarioOption({"s", "scenario"},
+		"Run only specified scenario: long_timeline, many_depths, "
+		"large_images, many_images or many_jpegs. "
+		"Can be specified multiple times.",
+		"name");
+
+	QCommandLineOption iterationsOption({"n", "iterations"},
+		"Number of conversions per scenario (Default is 3).", "value", "3");
+
+	QCommandLineOption samVesionOption(QStringList("sam-version"),
+		"Output SAM-file format version (Default is 2).", "value", "2");
+
+	QCommandLineOption streamingOption(
+		QStringList("streaming"), "Convert in streaming mode.");
+
+	QCommandLineOption scaleOption(QStringList("scale"),
+		"Output scale factor (Default is 1).", "value", "1");
+
+	QCommandLineOption resampleFilterOption(QStringList("resample-filter"),
+		"Image scaling filter: qt, box, bilinear or lanczos. "
+		"Default is qt.",
+		"filter", "qt");
+
+	QCommandLineOption profileFormatOption(QStringList("profile-format"),
+		"Stage report format: table, json or trace. Default is table.",
+		"format", "table");
+
+	QCommandLineOption baselineOption(QStringList("baseline"),
+		"Compare best time and peak memory of every scenario with "
+		"the JSON-file saved by --save-baseline. Exit code is 2 "
+		"if any scenario regresses.",
+		"json");
+
+	QCommandLineOption toleranceOption(QStringList("tolerance"),
+		"Allowed excess over the baseline in percent (Default is 10).",
+		"percent", "10");
+
+	QCommandLineOption saveBaselineOption(QStringList("save-baseline"),
+		"Save best time and peak memory of every scenario "
+		"to the JSON-file.",
+		"json");
+
+	QCommandLineOption runScenarioOption(QStringList("run-scenario"),
+		"Convert the generated SWF-file of a scenario in this process "
+		"only. Used internally to measure every scenario separately.",
+		"name");
+
+	parser.addOption(outputOption);
+	parser.addOption(scenarioOption);
+	parser.addOption(iterationsOption);
+	parser.addOption(samVesionOption);
+	parser.addOption(streamingOption);
+	parser.addOption(scaleOption);
+	parser.addOption(resampleFilterOption);
+	parser.addOption(profileFormatOption);
+	parser.addOption(baselineOption);
+	parser.addOption(toleranceOption);
+	parser.addOption(saveBaselineOption);
+	parser.addOption(runScenarioOption);
+
+	parser.process(a);
+
+	RunOptions options;
+
+	if (not Profiler::parseFormat(
+			parser.value(profileFormatOption), &options.profileFormat))
+	{
+		qCritical().noquote() << QString("Unknown profile format '%1'.")
+									 .arg(parser.value(profileFormatOption));
+		return EXIT_ERROR;
+	}
+
+	ImageResampler::Filter resampleFilter;
+
+	if (not ImageResampler::parseFilter(
+			parser.value(resampleFilterOption), &resampleFilter))
+	{
+		qCritical().noquote() << QString("Unknown resample filter '%1'.")
+									 .arg(parser.value(resampleFilterOption));
+		return EXIT_ERROR;
+	}
+
+	options.profileFormatName = parser.value(profileFormatOption);
+	options.resampler.setFilter(resampleFilter);
+	options.scale = parser.value(scaleOption).toDouble();
+	options.samVersion = parser.value(samVesionOption).toInt();
+	options.iterations = qMax(1, parser.value(iterationsOption).toInt());
+	options.streaming = parser.isSet(streamingOption);
+
+	QFile out;
+	out.open(stdout, QFile::WriteOnly);
+
+	if (parser.isSet(runScenarioOption))
+	{
+		options.workDirPath = parser.value(outputOption);
+
+		return convertScenario(options, parser.value(runScenarioOption), out)
+			? 0
+			: EXIT_ERROR;
+	}
+
+	if (not checkPixelConversion())
+	{
+		qCritical().noquote()
+			<< QString("%1 pixel conversion does not match scalar one.")
+				   .arg(PixelConversion::instructionSet());
+		return EXIT_ERROR;
+	}
+
+	if (not checkImageResampler())
+	{
+		qCritical().noquote()
+			<< QString("Vectorized image resampling does not match "
+					   "scalar one.");
+		return EXIT_ERROR;
+	}
+
+	QJsonObject baseline;
+
+	if (parser.isSet(baselineOption))
+	{
+		QFile baselineFile(parser.value(baselineOption));
+
+		auto doc = baselineFile.open(QFile::ReadOnly)
+			? QJsonDocument::fromJson(baselineFile.readAll())
+			: QJsonDocument();
+
+		if (not doc.isObject())
+		{
+			qCritical().noquote()
+				<< QString("Unable to read baseline '%1'.")
+					   .arg(baselineFile.fileName());
+			return EXIT_ERROR;
+		}
+
+		baseline = doc.object();
+	}
+
+	bool toleranceOk;
+	qreal tolerance = parser.value(toleranceOption).toDouble(&toleranceOk);
+
+	if (not toleranceOk || tolerance < 0.0)
+	{
+		qCritical().noquote() << QString("Bad tolerance value '%1'.")
+									 .arg(parser.value(toleranceOption));
+		return EXIT_ERROR;
+	}
+
+	QTemporaryDir tempDir;
+	options.workDirPath = parser.value(outputOption);
+
+	if (options.workDirPath.isEmpty())
+		options.workDirPath = tempDir.path();
+
+	QDir workDir(options.workDirPath);
+
+	if (not workDir.mkpath("."))
+	{
+		qCritical().noquote() << QString("Unable to create directory '%1'.")
+									 .arg(options.workDirPath);
+		return EXIT_ERROR;
+	}
+
+	options.workDirPath = workDir.absolutePath();
+
+	auto selected = parser.values(scenarioOption);
+
+	QJsonObject results;
+	int result = 0;
+
+	for (auto &params : scenarios())
+	{
+		if (not selected.isEmpty() && not selected.contains(params.name))
+			continue;
+
+		auto swfFilePath = workDir.filePath(params.name + ".swf");
+
+		QElapsedTimer timer;
+		timer.start();
+
+		if (not SWFGenerator::generate(params, swfFilePath))
+		{
+			qCritical().noquote()
+				<< QString("Unable to generate '%1'.").arg(swfFilePath);
+			result = EXIT_ERROR;
+			continue;
+		}
+
+		auto generateMs = timer.elapsed();
+
+		out.write(QString("== %1: %2 frames, %3 depths, %4 %5x%6 %7 images, "
+						  "%8 pixels, SWF %9 bytes generated in %10 ms\n")
+					  .arg(params.name)
+					  .arg(params.frameCount)
+					  .arg(params.depthCount)
+					  .arg(params.shapeCount)
+					  .arg(params.imageWidth)
+					  .arg(params.imageHeight)
+					  .arg(params.jpeg ? "JPEG" : "lossless")
+					  .arg(params.pixelCount())
+					  .arg(QFileInfo(swfFilePath).size())
+					  .arg(generateMs)
+					  .toUtf8());
+		out.flush();
+
+		QJsonObject scenarioResult;
+
+		if (not runScenarioProcess(options, params.name, &scenarioResult))
+		{
+			qCritical().noquote()
+				<< QString("Scenario '%1' failed.").arg(params.name);
+			result = EXIT_ERROR;
+			continue;
+		}
+
+		results.insert(params.name, scenarioResult);
+
+		auto scenarioBaseline = baseline.value(params.name);
+
+		if (scenarioBaseline.isObject() &&
+			not compareWithBaseline(params.name, scenarioResult,
+				scenarioBaseline.toObject(), tolerance) &&
+			result == 0)
+		{
+			result = EXIT_REGRESSION;
+		}
+	}
+
+	if (parser.isSet(saveBaselineOption))
+	{
+		QFile baselineFile(parser.value(saveBaselineOption));
+
+		if (not baselineFile.open(QFile::WriteOnly | QFile::Truncate) ||
+			baselineFile.write(QJsonDocument(results).toJson()) < 0)
+		{
+			qCritical().noquote() << QString("Unable to write baseline '%1'.")
+										 .arg(baselineFile.fileName());
+			result = EXIT_ERROR;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,33 @@
+# SWF to SAM animation converter benchmark project file
+# Uses Qt Framework from www.qt.io
+# Uses libraries from www.github.com/matthiaskramm/swftools
+
+VERSION = 1.0.0
+
+QMAKE_TARGET_PRODUCT = swf2sambench
+QMAKE_TARGET_DESCRIPTION = SWF to SAM animation converter benchmark
+QMAKE_TARGET_COPYRIGHT = Copyright (c) 2017 Alexandra Cherdantseva
+
+TARGET = swf2sambench
+CONFIG += console
+
+DEFINES += "APP_VERSION=\"\\\"v$$VERSION\\\"\""
+DEFINES += "APP_NAME=\"\\\"$$QMAKE_TARGET_PRODUCT\\\"\""
+DEFINES += "APP_DESCRIPTION=\"\\\"$$QMAKE_TARGET_DESCRIPTION\\\"\""
+
+TEMPLATE = app
+
+include(../libs/swflibs_dep.pri)
+
+include(../swf2sam/swf2sam.pri)
+
+SOURCES += \
+    main.cpp \
+    SWFGenerator.cpp
+
+HEADERS += \
+    SWFGenerator.h
+
+win32 {
+    LIBS += -lPsapi
+}
@@ -0,0 +1,95 @@
+// Part of SWF to SAM animation converter unit tests
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "ConverterInputTest.h"
+
+#include "Converter.h"
+#include "ConverterSink.h"
+#include "SWFGenerator.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QtTest>
+
+#include <memory>
+
+void ConverterInputTest::initTestCase()
+{
+	QVERIFY(mTempDir.isValid());
+
+	SWFGenerator::Params params;
+	params.name = "input";
+	params.frameCount = 4;
+	params.depthCount = 2;
+	params.shapeCount = 2;
+	params.imageWidth = 8;
+	params.imageHeight = 8;
+
+	auto filePath = mTempDir.filePath("input.swf");
+	QVERIFY(SWFGenerator::generate(params, filePath));
+
+	QFile file(filePath);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	mSWF = file.readAll();
+	QVERIFY(not mSWF.isEmpty());
+}
+
+void ConverterInputTest::addStreamingModes()
+{
+	QTest::addColumn<bool>("streaming");
+
+	QTest::newRow("read") << false;
+	QTest::newRow("stream") << true;
+}
+
+void ConverterInputTest::openDeviceStaysOpen_data()
+{
+	addStreamingModes();
+}
+
+void ConverterInputTest::openDeviceStaysOpen()
+{
+	QFETCH(bool, streaming);
+
+	QBuffer buffer;
+	buffer.setData(mSWF);
+	QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+	Converter converter;
+	converter.setInputFilePath("input.swf");
+	converter.setInputDevice(&buffer);
+	converter.setStreaming(streaming);
+	converter.setSink(std::make_shared<MemoryConverterSink>());
+
+	QCOMPARE(converter.exec(), int(Converter::OK));
+	QVERIFY(buffer.isOpen());
+
+	// Caller can keep using the device
+	QVERIFY(buffer.seek(0));
+	QCOMPARE(buffer.read(3), QByteArray("FWS"));
+}
+
+void ConverterInputTest::closedDeviceIsClosed_data()
+{
+	addStreamingModes();
+}
+
+void ConverterInputTest::closedDeviceIsClosed()
+{
+	QFETCH(bool, streaming);
+
+	QBuffer buffer;
+	buffer.setData(mSWF);
+
+	Converter converter;
+	converter.setInputFilePath("input.swf");
+	converter.setInputDevice(&buffer);
+	converter.setStreaming(streaming);
+	converter.setSink(std::make_shared<MemoryConverterSink>());
+
+	QCOMPARE(converter.exec(), int(Converter::OK));
+	QVERIFY(not buffer.isOpen());
+}
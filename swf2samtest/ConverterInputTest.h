@@ -0,0 +1,31 @@
+// Part of SWF to SAM animation converter unit tests
+// Uses Qt Framework from www.qt.io
+// Uses libraries from www.github.com/matthiaskramm/swftools
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QTemporaryDir>
+
+// Checks that Converter reads a device passed by the caller
+// without closing it and closes only a device it has opened itself.
+class ConverterInputTest : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void openDeviceStaysOpen_data();
+	void openDeviceStaysOpen();
+	void closedDeviceIsClosed_data();
+	void closedDeviceIsClosed();
+
+private:
+	static void addStreamingModes();
+
+	QTemporaryDir mTempDir;
+	QByteArray mSWF;
+};
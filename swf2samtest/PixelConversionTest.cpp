@@ -0,0 +1,123 @@
+// Part of SWF to SAM animation converter unit tests
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "PixelConversionTest.h"
+
+#include <QtTest>
+
+void PixelConversionTest::addInstructionSets()
+{
+	QTest::addColumn<PixelConversion::InstructionSet>("isa");
+
+	for (auto isa : {PixelConversion::SSE2, PixelConversion::AVX2})
+	{
+		QTest::newRow(PixelConversion::instructionSetName(isa)) << isa;
+	}
+}
+
+std::vector<quint8> PixelConversionTest::pattern(size_t size, int seed)
+{
+	std::vector<quint8> result(size);
+
+	for (size_t i = 0; i < size; i++)
+		result[i] = quint8(i * 31 + size_t(seed) * 7 + (i >> 8));
+
+	return result;
+}
+
+void PixelConversionTest::argbToRgba_data()
+{
+	addInstructionSets();
+}
+
+void PixelConversionTest::argbToRgba()
+{
+	QFETCH(PixelConversion::InstructionSet, isa);
+
+	if (not PixelConversion::isSupported(isa))
+		QSKIP("Instruction set is not supported by this CPU");
+
+	auto src = pattern(MAX_PIXELS * 4 + MAX_OFFSET, 1);
+	size_t dstSize = GUARD_SIZE * 2 + MAX_PIXELS * 4 + MAX_OFFSET;
+
+	for (int count = 0; count <= MAX_PIXELS; count++)
+	{
+		for (int srcOffset : {0, 1, 2, 3, 5, 16, 33})
+		{
+			for (int dstOffset : {0, 1, 3, 4, 7, 32, 33})
+			{
+				for (bool alpha : {false, true})
+				{
+					std::vector<quint8> expected(dstSize, GUARD_BYTE);
+					std::vector<quint8> actual(dstSize, GUARD_BYTE);
+
+					size_t dstStart = size_t(GUARD_SIZE + dstOffset);
+
+					PixelConversion::argbToRgbaScalar(&src[size_t(srcOffset)],
+						&expected[dstStart], count, alpha);
+					PixelConversion::argbToRgba(isa, &src[size_t(srcOffset)],
+						&actual[dstStart], count, alpha);
+
+					if (actual != expected)
+					{
+						QFAIL(qPrintable(
+							QString("Mismatch: count %1, source offset %2, "
+									"destination offset %3, alpha %4")
+								.arg(count)
+								.arg(srcOffset)
+								.arg(dstOffset)
+								.arg(int(alpha))));
+					}
+				}
+			}
+		}
+	}
+}
+
+void PixelConversionTest::mergeAlpha_data()
+{
+	addInstructionSets();
+}
+
+void PixelConversionTest::mergeAlpha()
+{
+	QFETCH(PixelConversion::InstructionSet, isa);
+
+	if (not PixelConversion::isSupported(isa))
+		QSKIP("Instruction set is not supported by this CPU");
+
+	auto alpha = pattern(MAX_PIXELS + MAX_OFFSET, 2);
+	size_t rgbaSize = GUARD_SIZE * 2 + MAX_PIXELS * 4 + MAX_OFFSET;
+	auto rgba = pattern(rgbaSize, 3);
+
+	for (int count = 0; count <= MAX_PIXELS; count++)
+	{
+		for (int alphaOffset : {0, 1, 2, 3, 5, 16, 33})
+		{
+			for (int rgbaOffset : {0, 1, 3, 4, 7, 32, 33})
+			{
+				auto expected = rgba;
+				auto actual = rgba;
+
+				size_t rgbaStart = size_t(GUARD_SIZE + rgbaOffset);
+
+				PixelConversion::mergeAlphaScalar(&expected[rgbaStart],
+					&alpha[size_t(alphaOffset)], count);
+				PixelConversion::mergeAlpha(isa, &actual[rgbaStart],
+					&alpha[size_t(alphaOffset)], count);
+
+				if (actual != expected)
+				{
+					QFAIL(qPrintable(
+						QString("Mismatch: count %1, alpha offset %2, "
+								"RGBA offset %3")
+							.arg(count)
+							.arg(alphaOffset)
+							.arg(rgbaOffset)));
+				}
+			}
+		}
+	}
+}
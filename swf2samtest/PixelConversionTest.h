@@ -0,0 +1,40 @@
+// Part of SWF to SAM animation converter unit tests
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#pragma once
+
+#include "PixelConversion.h"
+
+#include <QObject>
+
+#include <vector>
+
+Q_DECLARE_METATYPE(PixelConversion::InstructionSet)
+
+// Checks vectorized kernels against the scalar ones for every length
+// up to a few vector widths and for unaligned source and destination.
+// Bytes around the destination range must stay untouched.
+class PixelConversionTest : public QObject
+{
+	Q_OBJECT
+
+	enum
+	{
+		MAX_PIXELS = 100,
+		MAX_OFFSET = 33,
+		GUARD_SIZE = 64,
+		GUARD_BYTE = 0xCD
+	};
+
+private slots:
+	void argbToRgba_data();
+	void argbToRgba();
+	void mergeAlpha_data();
+	void mergeAlpha();
+
+private:
+	static void addInstructionSets();
+	static std::vector<quint8> pattern(size_t size, int seed);
+};
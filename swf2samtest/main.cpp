@@ -0,0 +1,29 @@
+// Part of SWF to SAM animation converter unit tests
+// Uses Qt Framework from www.qt.io
+//
+// Copyright (c) 2017 Alexandra Cherdantseva
+
+#include "PixelConversionTest.h"
+#include "ConverterInputTest.h"
+
+#include <QCoreApplication>
+#include <QtTest>
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	int result = 0;
+
+	{
+		PixelConversionTest test;
+		result |= QTest::qExec(&test, argc, argv);
+	}
+
+	{
+		ConverterInputTest test;
+		result |= QTest::qExec(&test, argc, argv);
+	}
+
+	return result;
+}
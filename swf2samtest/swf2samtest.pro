@@ -0,0 +1,30 @@
+# SWF to SAM animation converter unit tests project file
+# Uses Qt Framework from www.qt.io
+# Uses libraries from www.github.com/matthiaskramm/swftools
+# Run with 'make check'
+
+QT += testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = swf2samtest
+TEMPLATE = app
+
+include(../libs/swflibs_dep.pri)
+
+include(../swf2sam/swf2sam.pri)
+
+# Synthetic SWF-files are made by the benchmark generator
+INCLUDEPATH += ../swf2sambench
+
+SOURCES += \
+    main.cpp \
+    ConverterInputTest.cpp \
+    PixelConversionTest.cpp \
+    ../swf2sambench/SWFGenerator.cpp
+
+HEADERS += \
+    ConverterInputTest.h \
+    PixelConversionTest.h \
+    ../swf2sambench/SWFGenerator.h
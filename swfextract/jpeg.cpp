@@ -10,6 +10,31 @@
 
 #include "jpeg.h"
 
+#ifdef SWF2SAM_LIBJPEG
+#include "JpegDecoder.h"
+#include "SegmentedDevice.h"
+#endif
+
+static QImage jpegDecode(const unsigned char *data, int size)
+{
+#ifdef SWF2SAM_LIBJPEG
+	SegmentedDevice device;
+	device.addSegment(reinterpret_cast<const char *>(data), size);
+
+	QImage image;
+	QSize originalSize;
+
+	// Decoded straight to the format expected by imageLoad
+	if (JpegDecoder::decode(
+			device, 1.0, QImage::Format_ARGB32, &image, &originalSize))
+	{
+		return image;
+	}
+#endif
+
+	return QImage::fromData(data, size, "jpeg");
+}
+
 extern "C"
 {
 
@@ -131,8 +156,15 @@ int jpeg_load(
 	const char *filename, unsigned char **dest, unsigned int *width,
 	unsigned int *height)
 {
-	QImage image;
-	if (not image.load(QString::fromLocal8Bit(filename), "jpeg"))
+	QFile file(QString::fromLocal8Bit(filename));
+	if (not file.open(QIODevice::ReadOnly))
+		return 0;
+
+	auto data = file.readAll();
+	auto image = jpegDecode(
+		reinterpret_cast<const unsigned char *>(data.constData()),
+		data.size());
+	if (image.isNull())
 		return 0;
 
 	imageLoad(image, dest, width, height);
@@ -143,7 +175,7 @@ int jpeg_load_from_mem(
 	unsigned char *_data, int _size, unsigned char **dest,
 	unsigned int *width, unsigned int *height)
 {
-	auto image = QImage::fromData(_data, _size, "jpeg");
+	auto image = jpegDecode(_data, _size);
 	if (image.isNull())
 		return 0;
 
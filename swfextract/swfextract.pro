@@ -17,6 +17,21 @@ SOURCES += \
 HEADERS += \
     $$SWFTOOLSROOT/lib/jpeg.h
 
+# Configure with CONFIG+=swfextract_libjpeg to decode with libjpeg-turbo
+swfextract_libjpeg {
+    DEFINES += SWF2SAM_LIBJPEG
+    LIBS += -ljpeg
+    INCLUDEPATH += ../swf2sam
+
+    SOURCES += \
+        ../swf2sam/JpegDecoder.cpp \
+        ../swf2sam/SegmentedDevice.cpp
+
+    HEADERS += \
+        ../swf2sam/JpegDecoder.h \
+        ../swf2sam/SegmentedDevice.h
+}
+
 win32-g++ {
 } else {
     win32 {